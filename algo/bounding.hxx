@@ -7,8 +7,10 @@
 #include <functional>
 #include <initializer_list>
 #include <numeric>
+#include <iterator>
 
 #include "../main/types.hxx"
+#include "../main/instrument.hxx"
 
 template<typename It>
 const range_t calculate_aabb(const It& begin, const It& end)
@@ -19,8 +21,9 @@ const range_t calculate_aabb(const It& begin, const It& end)
 			vertex_t(std::numeric_limits<coord_t>::infinity()),
 			vertex_t(-std::numeric_limits<coord_t>::infinity())
 		),
-		[] (range_t minmax, const vertex_t& v)
+		[] (range_t minmax, const typename std::iterator_traits<It>::value_type& vert)
 		{
+			const vertex_t& v = to_vertex(vert);
 			return std::move(
 				range_t(
 					std::move(std::get<0>(minmax).min(v)),
@@ -43,9 +46,18 @@ inline const range_t calculate_aabb(const vertex_set_t& vs)
 
 inline const range_t calculate_aabb(const model_t& m)
 {
+	INSTRUMENT_TIMER(aabb);
 	return std::move(calculate_aabb(m.vertex_set()));
 }
 
+// any other precision (see precision.hxx), the range is always in double
+template<typename VST, typename MT>
+inline const range_t calculate_aabb(const model<VST, MT>& m)
+{
+	INSTRUMENT_TIMER(aabb);
+	return std::move(calculate_aabb(m.vertex_set().begin(), m.vertex_set().end()));
+}
+
 #endif // BOUNDING_HEADER_FILE
 
 
@@ -0,0 +1,448 @@
+#ifndef SIMD_HEADER_FILE
+#define SIMD_HEADER_FILE
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include "../main/types.hxx"
+#include "../main/soa.hxx"
+#include "../main/parallel.hxx"
+#include "surface.hxx"
+#include "volume.hxx"
+#include "stats.hxx"
+
+///////////////////////////////////////////
+//   SIMD kernels on SoA vertex sets     //
+///////////////////////////////////////////
+
+// Every kernel comes in a scalar, an SSE2 and an AVX2 flavour. The best one
+// the CPU supports is picked at runtime (the AVX2 code is compiled for that
+// target only, the rest of the program isn't).
+
+namespace simd
+{
+
+enum class isa { scalar, sse2, avx2 };
+
+inline const bool supported(const isa i)
+{
+	switch(i)
+	{
+#ifdef SIMD_X86
+		case isa::avx2: return __builtin_cpu_supports("avx2");
+		case isa::sse2: return __builtin_cpu_supports("sse2");
+#endif
+		case isa::scalar: return true;
+		default: return false;
+	}
+}
+
+inline const isa best()
+{
+	static const isa b =
+		supported(isa::avx2) ? isa::avx2
+		: supported(isa::sse2) ? isa::sse2
+		: isa::scalar;
+	return b;
+}
+
+// surface and signed volume of a range of faces
+struct face_sums
+{
+	compensated_sum surf;
+	compensated_sum vol;
+};
+
+namespace detail
+{
+
+inline range_t aabb_scalar(const coord_t* x, const coord_t* y, const coord_t* z, const index_t n)
+{
+	coord_t mn[3] = {
+		std::numeric_limits<coord_t>::infinity(),
+		std::numeric_limits<coord_t>::infinity(),
+		std::numeric_limits<coord_t>::infinity() };
+	coord_t mx[3] = { -mn[0], -mn[1], -mn[2] };
+	for(index_t i = 0; i < n; i++)
+	{
+		mn[0] = std::min(x[i], mn[0]);
+		mn[1] = std::min(y[i], mn[1]);
+		mn[2] = std::min(z[i], mn[2]);
+		mx[0] = std::max(x[i], mx[0]);
+		mx[1] = std::max(y[i], mx[1]);
+		mx[2] = std::max(z[i], mx[2]);
+	}
+	return range_t(
+		vertex_t(std::make_tuple(mn[0], mn[1], mn[2])),
+		vertex_t(std::make_tuple(mx[0], mx[1], mx[2])));
+}
+
+inline void face_scalar(
+	const coord_t* x, const coord_t* y, const coord_t* z,
+	const face_t& f,
+	face_sums& sums)
+{
+	const vertex_t a(std::make_tuple(x[f.a()], y[f.a()], z[f.a()]));
+	const vertex_t b(std::make_tuple(x[f.b()], y[f.b()], z[f.b()]));
+	const vertex_t c(std::make_tuple(x[f.c()], y[f.c()], z[f.c()]));
+	sums.surf.add(triangle_surface(a, b, c));
+	sums.vol.add(signed_volume(a, b, c));
+}
+
+inline face_sums faces_scalar(
+	const coord_t* x, const coord_t* y, const coord_t* z,
+	const face_t* faces, const index_t n)
+{
+	face_sums sums;
+	for(index_t i = 0; i < n; i++)
+	{
+		face_scalar(x, y, z, faces[i], sums);
+	}
+	return sums;
+}
+
+#ifdef SIMD_X86
+
+// adds the (Kahan-compensated) lanes of a vector sum to a compensated_sum
+inline void add_lanes(compensated_sum& s, const double* sum, const double* err, const int lanes)
+{
+	for(int i = 0; i < lanes; i++)
+	{
+		s.add(sum[i]);
+		s.add(-err[i]);
+	}
+}
+
+inline range_t aabb_sse2(const coord_t* x, const coord_t* y, const coord_t* z, const index_t n)
+{
+	__m128d mnx = _mm_set1_pd(std::numeric_limits<coord_t>::infinity());
+	__m128d mny = mnx, mnz = mnx;
+	__m128d mxx = _mm_set1_pd(-std::numeric_limits<coord_t>::infinity());
+	__m128d mxy = mxx, mxz = mxx;
+	index_t i = 0;
+	for(; i + 2 <= n; i += 2)
+	{
+		const __m128d vx = _mm_loadu_pd(x + i);
+		const __m128d vy = _mm_loadu_pd(y + i);
+		const __m128d vz = _mm_loadu_pd(z + i);
+		mnx = _mm_min_pd(mnx, vx);
+		mny = _mm_min_pd(mny, vy);
+		mnz = _mm_min_pd(mnz, vz);
+		mxx = _mm_max_pd(mxx, vx);
+		mxy = _mm_max_pd(mxy, vy);
+		mxz = _mm_max_pd(mxz, vz);
+	}
+	alignas(16) double r[6][2];
+	_mm_store_pd(r[0], mnx);
+	_mm_store_pd(r[1], mny);
+	_mm_store_pd(r[2], mnz);
+	_mm_store_pd(r[3], mxx);
+	_mm_store_pd(r[4], mxy);
+	_mm_store_pd(r[5], mxz);
+	const range_t tail = aabb_scalar(x + i, y + i, z + i, n - i);
+	return range_t(
+		vertex_t(std::make_tuple(
+			std::min({ r[0][0], r[0][1], tail.first.x() }),
+			std::min({ r[1][0], r[1][1], tail.first.y() }),
+			std::min({ r[2][0], r[2][1], tail.first.z() }))),
+		vertex_t(std::make_tuple(
+			std::max({ r[3][0], r[3][1], tail.second.x() }),
+			std::max({ r[4][0], r[4][1], tail.second.y() }),
+			std::max({ r[5][0], r[5][1], tail.second.z() }))));
+}
+
+inline face_sums faces_sse2(
+	const coord_t* x, const coord_t* y, const coord_t* z,
+	const face_t* faces, const index_t n)
+{
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d sixth = _mm_set1_pd(6);
+	__m128d ssum = _mm_setzero_pd(), serr = _mm_setzero_pd();
+	__m128d vsum = _mm_setzero_pd(), verr = _mm_setzero_pd();
+	index_t i = 0;
+	for(; i + 2 <= n; i += 2)
+	{
+		const face_t& f0 = faces[i];
+		const face_t& f1 = faces[i + 1];
+		const __m128d ax = _mm_set_pd(x[f1.a()], x[f0.a()]);
+		const __m128d ay = _mm_set_pd(y[f1.a()], y[f0.a()]);
+		const __m128d az = _mm_set_pd(z[f1.a()], z[f0.a()]);
+		const __m128d bx = _mm_set_pd(x[f1.b()], x[f0.b()]);
+		const __m128d by = _mm_set_pd(y[f1.b()], y[f0.b()]);
+		const __m128d bz = _mm_set_pd(z[f1.b()], z[f0.b()]);
+		const __m128d cx = _mm_set_pd(x[f1.c()], x[f0.c()]);
+		const __m128d cy = _mm_set_pd(y[f1.c()], y[f0.c()]);
+		const __m128d cz = _mm_set_pd(z[f1.c()], z[f0.c()]);
+
+		// surface: |(b - a) x (c - a)| / 2
+		const __m128d ux = _mm_sub_pd(bx, ax), uy = _mm_sub_pd(by, ay), uz = _mm_sub_pd(bz, az);
+		const __m128d wx = _mm_sub_pd(cx, ax), wy = _mm_sub_pd(cy, ay), wz = _mm_sub_pd(cz, az);
+		const __m128d nx = _mm_sub_pd(_mm_mul_pd(uy, wz), _mm_mul_pd(uz, wy));
+		const __m128d ny = _mm_sub_pd(_mm_mul_pd(ux, wz), _mm_mul_pd(uz, wx));
+		const __m128d nz = _mm_sub_pd(_mm_mul_pd(ux, wy), _mm_mul_pd(uy, wx));
+		const __m128d s = _mm_mul_pd(half, _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(
+			_mm_mul_pd(nx, nx), _mm_mul_pd(ny, ny)), _mm_mul_pd(nz, nz))));
+
+		// signed volume of the tetrahedron with the origin (as signed_volume)
+		__m128d v = _mm_mul_pd(_mm_mul_pd(bx, cy), az);
+		v = _mm_add_pd(v, _mm_mul_pd(_mm_mul_pd(cx, ay), bz));
+		v = _mm_add_pd(v, _mm_mul_pd(_mm_mul_pd(ax, by), cz));
+		v = _mm_sub_pd(v, _mm_mul_pd(_mm_mul_pd(ax, cy), bz));
+		v = _mm_sub_pd(v, _mm_mul_pd(_mm_mul_pd(bx, ay), cz));
+		v = _mm_sub_pd(v, _mm_mul_pd(_mm_mul_pd(cx, by), az));
+		v = _mm_div_pd(v, sixth);
+
+		// Kahan summation per lane
+		__m128d t, d;
+		d = _mm_sub_pd(s, serr);
+		t = _mm_add_pd(ssum, d);
+		serr = _mm_sub_pd(_mm_sub_pd(t, ssum), d);
+		ssum = t;
+		d = _mm_sub_pd(v, verr);
+		t = _mm_add_pd(vsum, d);
+		verr = _mm_sub_pd(_mm_sub_pd(t, vsum), d);
+		vsum = t;
+	}
+	alignas(16) double r[4][2];
+	_mm_store_pd(r[0], ssum);
+	_mm_store_pd(r[1], serr);
+	_mm_store_pd(r[2], vsum);
+	_mm_store_pd(r[3], verr);
+
+	face_sums sums;
+	add_lanes(sums.surf, r[0], r[1], 2);
+	add_lanes(sums.vol, r[2], r[3], 2);
+	for(; i < n; i++)
+	{
+		face_scalar(x, y, z, faces[i], sums);
+	}
+	return sums;
+}
+
+__attribute__((target("avx2")))
+inline range_t aabb_avx2(const coord_t* x, const coord_t* y, const coord_t* z, const index_t n)
+{
+	__m256d mnx = _mm256_set1_pd(std::numeric_limits<coord_t>::infinity());
+	__m256d mny = mnx, mnz = mnx;
+	__m256d mxx = _mm256_set1_pd(-std::numeric_limits<coord_t>::infinity());
+	__m256d mxy = mxx, mxz = mxx;
+	// second set of accumulators, to keep more min/max in flight
+	__m256d mnx2 = mnx, mny2 = mnx, mnz2 = mnx;
+	__m256d mxx2 = mxx, mxy2 = mxx, mxz2 = mxx;
+	index_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		const __m256d vx = _mm256_loadu_pd(x + i);
+		const __m256d vy = _mm256_loadu_pd(y + i);
+		const __m256d vz = _mm256_loadu_pd(z + i);
+		const __m256d vx2 = _mm256_loadu_pd(x + i + 4);
+		const __m256d vy2 = _mm256_loadu_pd(y + i + 4);
+		const __m256d vz2 = _mm256_loadu_pd(z + i + 4);
+		mnx = _mm256_min_pd(mnx, vx);
+		mny = _mm256_min_pd(mny, vy);
+		mnz = _mm256_min_pd(mnz, vz);
+		mxx = _mm256_max_pd(mxx, vx);
+		mxy = _mm256_max_pd(mxy, vy);
+		mxz = _mm256_max_pd(mxz, vz);
+		mnx2 = _mm256_min_pd(mnx2, vx2);
+		mny2 = _mm256_min_pd(mny2, vy2);
+		mnz2 = _mm256_min_pd(mnz2, vz2);
+		mxx2 = _mm256_max_pd(mxx2, vx2);
+		mxy2 = _mm256_max_pd(mxy2, vy2);
+		mxz2 = _mm256_max_pd(mxz2, vz2);
+	}
+	mnx = _mm256_min_pd(mnx, mnx2);
+	mny = _mm256_min_pd(mny, mny2);
+	mnz = _mm256_min_pd(mnz, mnz2);
+	mxx = _mm256_max_pd(mxx, mxx2);
+	mxy = _mm256_max_pd(mxy, mxy2);
+	mxz = _mm256_max_pd(mxz, mxz2);
+	alignas(32) double r[6][4];
+	_mm256_store_pd(r[0], mnx);
+	_mm256_store_pd(r[1], mny);
+	_mm256_store_pd(r[2], mnz);
+	_mm256_store_pd(r[3], mxx);
+	_mm256_store_pd(r[4], mxy);
+	_mm256_store_pd(r[5], mxz);
+	const range_t tail = aabb_scalar(x + i, y + i, z + i, n - i);
+	return range_t(
+		vertex_t(std::make_tuple(
+			std::min({ r[0][0], r[0][1], r[0][2], r[0][3], tail.first.x() }),
+			std::min({ r[1][0], r[1][1], r[1][2], r[1][3], tail.first.y() }),
+			std::min({ r[2][0], r[2][1], r[2][2], r[2][3], tail.first.z() }))),
+		vertex_t(std::make_tuple(
+			std::max({ r[3][0], r[3][1], r[3][2], r[3][3], tail.second.x() }),
+			std::max({ r[4][0], r[4][1], r[4][2], r[4][3], tail.second.y() }),
+			std::max({ r[5][0], r[5][1], r[5][2], r[5][3], tail.second.z() }))));
+}
+
+__attribute__((target("avx2")))
+inline face_sums faces_avx2(
+	const coord_t* x, const coord_t* y, const coord_t* z,
+	const face_t* faces, const index_t n)
+{
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d sixth = _mm256_set1_pd(6);
+	__m256d ssum = _mm256_setzero_pd(), serr = _mm256_setzero_pd();
+	__m256d vsum = _mm256_setzero_pd(), verr = _mm256_setzero_pd();
+	index_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		const face_t* f = faces + i;
+		const __m256i ia = _mm256_set_epi64x(f[3].a(), f[2].a(), f[1].a(), f[0].a());
+		const __m256i ib = _mm256_set_epi64x(f[3].b(), f[2].b(), f[1].b(), f[0].b());
+		const __m256i ic = _mm256_set_epi64x(f[3].c(), f[2].c(), f[1].c(), f[0].c());
+		const __m256d ax = _mm256_i64gather_pd(x, ia, 8);
+		const __m256d ay = _mm256_i64gather_pd(y, ia, 8);
+		const __m256d az = _mm256_i64gather_pd(z, ia, 8);
+		const __m256d bx = _mm256_i64gather_pd(x, ib, 8);
+		const __m256d by = _mm256_i64gather_pd(y, ib, 8);
+		const __m256d bz = _mm256_i64gather_pd(z, ib, 8);
+		const __m256d cx = _mm256_i64gather_pd(x, ic, 8);
+		const __m256d cy = _mm256_i64gather_pd(y, ic, 8);
+		const __m256d cz = _mm256_i64gather_pd(z, ic, 8);
+
+		// surface: |(b - a) x (c - a)| / 2
+		const __m256d ux = _mm256_sub_pd(bx, ax), uy = _mm256_sub_pd(by, ay), uz = _mm256_sub_pd(bz, az);
+		const __m256d wx = _mm256_sub_pd(cx, ax), wy = _mm256_sub_pd(cy, ay), wz = _mm256_sub_pd(cz, az);
+		const __m256d nx = _mm256_sub_pd(_mm256_mul_pd(uy, wz), _mm256_mul_pd(uz, wy));
+		const __m256d ny = _mm256_sub_pd(_mm256_mul_pd(ux, wz), _mm256_mul_pd(uz, wx));
+		const __m256d nz = _mm256_sub_pd(_mm256_mul_pd(ux, wy), _mm256_mul_pd(uy, wx));
+		const __m256d s = _mm256_mul_pd(half, _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(
+			_mm256_mul_pd(nx, nx), _mm256_mul_pd(ny, ny)), _mm256_mul_pd(nz, nz))));
+
+		// signed volume of the tetrahedron with the origin (as signed_volume)
+		__m256d v = _mm256_mul_pd(_mm256_mul_pd(bx, cy), az);
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(cx, ay), bz));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(ax, by), cz));
+		v = _mm256_sub_pd(v, _mm256_mul_pd(_mm256_mul_pd(ax, cy), bz));
+		v = _mm256_sub_pd(v, _mm256_mul_pd(_mm256_mul_pd(bx, ay), cz));
+		v = _mm256_sub_pd(v, _mm256_mul_pd(_mm256_mul_pd(cx, by), az));
+		v = _mm256_div_pd(v, sixth);
+
+		// Kahan summation per lane
+		__m256d t, d;
+		d = _mm256_sub_pd(s, serr);
+		t = _mm256_add_pd(ssum, d);
+		serr = _mm256_sub_pd(_mm256_sub_pd(t, ssum), d);
+		ssum = t;
+		d = _mm256_sub_pd(v, verr);
+		t = _mm256_add_pd(vsum, d);
+		verr = _mm256_sub_pd(_mm256_sub_pd(t, vsum), d);
+		vsum = t;
+	}
+	alignas(32) double r[4][4];
+	_mm256_store_pd(r[0], ssum);
+	_mm256_store_pd(r[1], serr);
+	_mm256_store_pd(r[2], vsum);
+	_mm256_store_pd(r[3], verr);
+
+	face_sums sums;
+	add_lanes(sums.surf, r[0], r[1], 4);
+	add_lanes(sums.vol, r[2], r[3], 4);
+	for(; i < n; i++)
+	{
+		face_scalar(x, y, z, faces[i], sums);
+	}
+	return sums;
+}
+
+#endif // SIMD_X86
+
+inline range_t aabb_kernel(const isa i, const coord_t* x, const coord_t* y, const coord_t* z, const index_t n)
+{
+	switch(i)
+	{
+#ifdef SIMD_X86
+		case isa::avx2: return aabb_avx2(x, y, z, n);
+		case isa::sse2: return aabb_sse2(x, y, z, n);
+#endif
+		default: return aabb_scalar(x, y, z, n);
+	}
+}
+
+inline face_sums faces_kernel(const isa i, const coord_t* x, const coord_t* y, const coord_t* z, const face_t* f, const index_t n)
+{
+	switch(i)
+	{
+#ifdef SIMD_X86
+		case isa::avx2: return faces_avx2(x, y, z, f, n);
+		case isa::sse2: return faces_sse2(x, y, z, f, n);
+#endif
+		default: return faces_scalar(x, y, z, f, n);
+	}
+}
+
+} // namespace detail
+
+} // namespace simd
+
+inline const range_t calculate_aabb(const soa_vertex_set_t& vs, const simd::isa i = simd::best())
+{
+	return simd::detail::aabb_kernel(i, vs.x_data(), vs.y_data(), vs.z_data(), vs.size());
+}
+
+inline const range_t calculate_aabb(const soa_model_t& m, const simd::isa i = simd::best())
+{
+	INSTRUMENT_TIMER(aabb);
+	return calculate_aabb(m.vertex_set(), i);
+}
+
+inline const scalar_t calculate_surface(const soa_model_t& m, const simd::isa i = simd::best())
+{
+	INSTRUMENT_TIMER(surface);
+	const soa_vertex_set_t& vs = m.vertex_set();
+	return simd::detail::faces_kernel(i, vs.x_data(), vs.y_data(), vs.z_data(), m.mesh().data(), m.mesh().size())
+		.surf.value();
+}
+
+inline const scalar_t calculate_volume(const soa_model_t& m, const simd::isa i = simd::best())
+{
+	INSTRUMENT_TIMER(volume);
+	const soa_vertex_set_t& vs = m.vertex_set();
+	return simd::detail::faces_kernel(i, vs.x_data(), vs.y_data(), vs.z_data(), m.mesh().data(), m.mesh().size())
+		.vol.value();
+}
+
+// as calculate_mesh_stats for model_t (same blocks, same reduction)
+inline mesh_stats calculate_mesh_stats(
+	const soa_model_t& m,
+	const unsigned threads = default_threads(),
+	const simd::isa i = simd::best())
+{
+	INSTRUMENT_TIMER(stats);
+	const soa_vertex_set_t& vs = m.vertex_set();
+	const mesh_t& mesh = m.mesh();
+	const size_t n = std::max<size_t>(1,
+		(std::max(vs.size(), mesh.size()) + stats_block - 1) / stats_block);
+
+	std::vector<mesh_stats> blocks(n);
+	parallel_for(n, threads, [ &vs, &mesh, &blocks, i ] (const size_t b)
+	{
+		const index_t vb = std::min(vs.size(), b * stats_block);
+		const index_t ve = std::min(vs.size(), (b + 1) * stats_block);
+		const range_t r = simd::detail::aabb_kernel(i,
+			vs.x_data() + vb, vs.y_data() + vb, vs.z_data() + vb, ve - vb);
+
+		const index_t fb = std::min(mesh.size(), b * stats_block);
+		const index_t fe = std::min(mesh.size(), (b + 1) * stats_block);
+		const simd::face_sums s = simd::detail::faces_kernel(i,
+			vs.x_data(), vs.y_data(), vs.z_data(), mesh.data() + fb, fe - fb);
+
+		mesh_stats& st = blocks[b];
+		st.add_range(r);
+		st.surf += s.surf;
+		st.vol += s.vol;
+	});
+
+	return reduce_stats(blocks, 0, n);
+}
+
+#endif // SIMD_HEADER_FILE
@@ -0,0 +1,177 @@
+#ifndef STATS_HEADER_FILE
+#define STATS_HEADER_FILE
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../main/types.hxx"
+#include "../main/instrument.hxx"
+#include "../main/parallel.hxx"
+#include "surface.hxx"
+#include "volume.hxx"
+
+// compensated (Neumaier) summation: keeps track of the rounding error
+// of every addition, so the sum of millions of small terms stays accurate
+struct compensated_sum
+{
+	scalar_t sum = 0;
+	scalar_t err = 0;
+
+	void add(const scalar_t v)
+	{
+		const scalar_t t = sum + v;
+		err += std::abs(sum) >= std::abs(v)
+			? (sum - t) + v
+			: (v - t) + sum;
+		sum = t;
+	}
+
+	compensated_sum& operator+=(const compensated_sum& o)
+	{
+		add(o.sum);
+		err += o.err;
+		return *this;
+	}
+
+	const scalar_t value() const { return sum + err; }
+};
+
+// partial (or complete) statistics of a mesh
+struct mesh_stats
+{
+	range_t box;
+	compensated_sum surf;
+	compensated_sum vol;
+
+	mesh_stats()
+	: box(
+		vertex_t(std::numeric_limits<coord_t>::infinity()),
+		vertex_t(-std::numeric_limits<coord_t>::infinity())) {}
+
+	const range_t& range() const { return box; }
+	const scalar_t surface() const { return surf.value(); }
+	const scalar_t volume() const { return vol.value(); }
+
+	void add_vertex(const vertex_t& v)
+	{
+		box.first = box.first.min(v);
+		box.second = box.second.max(v);
+	}
+
+	void add_face(const vertex_t& v1, const vertex_t& v2, const vertex_t& v3)
+	{
+		surf.add(triangle_surface(v1, v2, v3));
+		vol.add(signed_volume(v1, v2, v3));
+	}
+
+	void add_range(const range_t& r)
+	{
+		box.first = box.first.min(r.first);
+		box.second = box.second.max(r.second);
+	}
+
+	mesh_stats& operator+=(const mesh_stats& o)
+	{
+		add_range(o.box);
+		surf += o.surf;
+		vol += o.vol;
+		return *this;
+	}
+};
+
+// faces (and vertices) per block of work
+const index_t stats_block = index_t(1) << 14;
+
+// combines the partial results of blocks [b, e) two by two (split at the
+// largest power of two below e - b), so the order of all additions is fixed
+// by the number of blocks only
+inline mesh_stats reduce_stats(const std::vector<mesh_stats>& blocks, const size_t b, const size_t e)
+{
+	if(e - b == 1)
+	{
+		return blocks[b];
+	}
+	size_t half = 1;
+	while(half * 2 < e - b)
+	{
+		half *= 2;
+	}
+	mesh_stats res = reduce_stats(blocks, b, b + half);
+	res += reduce_stats(blocks, b + half, e);
+	return res;
+}
+
+// the same reduction as reduce_stats, for blocks that arrive one by one (and
+// without knowing how many there will be): complete subtrees of a power of two
+// blocks are kept on a stack and merged like the digits of a binary counter,
+// result() merges what is left from right to left. Blocks without any faces
+// at the end don't change surface or volume.
+class stats_reducer
+{
+private:
+	std::vector<std::pair<size_t, mesh_stats>> stack; // (blocks, their reduction)
+
+public:
+	void push(const mesh_stats& block)
+	{
+		stack.push_back(std::make_pair(size_t(1), block));
+		while(stack.size() >= 2 && stack[stack.size() - 2].first == stack.back().first)
+		{
+			std::pair<size_t, mesh_stats>& left = stack[stack.size() - 2];
+			left.first *= 2;
+			left.second += stack.back().second;
+			stack.pop_back();
+		}
+	}
+
+	const mesh_stats result() const
+	{
+		if(stack.empty())
+		{
+			return mesh_stats();
+		}
+		mesh_stats res = stack.back().second;
+		for(size_t i = stack.size() - 1; i-- > 0; )
+		{
+			mesh_stats left = stack[i].second;
+			left += res;
+			res = left;
+		}
+		return res;
+	}
+};
+
+// aabb (over all vertices), surface and (signed) volume in one traversal.
+// the mesh is cut in fixed-size blocks that are handled in parallel and reduced
+// in a fixed order: the result does not depend on the number of threads.
+// (for any precision, see precision.hxx)
+template<typename VST, typename MT>
+inline mesh_stats calculate_mesh_stats(const model<VST, MT>& m, const unsigned threads = default_threads())
+{
+	INSTRUMENT_TIMER(stats);
+	const VST& vs = m.vertex_set();
+	const MT& mesh = m.mesh();
+	const size_t n = std::max<size_t>(1,
+		(std::max(vs.size(), mesh.size()) + stats_block - 1) / stats_block);
+
+	std::vector<mesh_stats> blocks(n);
+	parallel_for(n, threads, [ &vs, &mesh, &blocks ] (const size_t b)
+	{
+		mesh_stats& st = blocks[b];
+		for(index_t i = b * stats_block; i < std::min(vs.size(), (b + 1) * stats_block); i++)
+		{
+			st.add_vertex(to_vertex(vs[i]));
+		}
+		for(index_t i = b * stats_block; i < std::min(mesh.size(), (b + 1) * stats_block); i++)
+		{
+			const typename MT::value_type& f = mesh[i];
+			st.add_face(to_vertex(vs[f.a()]), to_vertex(vs[f.b()]), to_vertex(vs[f.c()]));
+		}
+	});
+
+	return reduce_stats(blocks, 0, n);
+}
+
+#endif // STATS_HEADER_FILE
@@ -2,23 +2,31 @@
 #define SURFACE_HEADER_FILE
 
 #include <cmath>
+#include <numeric>
 
 #include "../main/types.hxx"
+#include "../main/instrument.hxx"
 
-const scalar_t calculate_surface(const model_t& m)
+inline scalar_t triangle_surface(const vertex_t& v1, const vertex_t& v2, const vertex_t& v3)
 {
+	return ((v1.to(v2)).cross(v1.to(v3))).norm() / 2;
+}
+
+// (for any precision, see precision.hxx)
+template<typename VST, typename MT>
+inline const scalar_t calculate_surface(const model<VST, MT>& m)
+{
+	INSTRUMENT_TIMER(surface);
 	return std::accumulate(
 		m.mesh().begin(),
 		m.mesh().end(),
 		scalar_t(0),
-		[ &m ] (scalar_t surf, const face_t& f)
+		[ &m ] (scalar_t surf, const typename MT::value_type& f)
 		{
-			vertex_t v1 = m.vertex_set()[f.a()];
-			vertex_t v2 = m.vertex_set()[f.b()];
-			vertex_t v3 = m.vertex_set()[f.c()];
-
-			return surf + ((v1.to(v2)).cross(v1.to(v3))).norm() / 2;
-			
+			return surf + triangle_surface(
+				to_vertex(m.vertex_set()[f.a()]),
+				to_vertex(m.vertex_set()[f.b()]),
+				to_vertex(m.vertex_set()[f.c()]));
 		}
 	);
 }
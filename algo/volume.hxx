@@ -4,10 +4,11 @@
 #include <cmath>
 
 #include "../main/types.hxx"
+#include "../main/instrument.hxx"
 #include "surface.hxx"
 
 
-scalar_t signed_volume(const vertex_t& p1, const vertex_t& p2, const vertex_t& p3)
+inline scalar_t signed_volume(const vertex_t& p1, const vertex_t& p2, const vertex_t& p3)
 {
 	return (p2.x() * p3.y() * p1.z()
 		+ p3.x() * p1.y() * p2.z()
@@ -18,18 +19,21 @@ scalar_t signed_volume(const vertex_t& p1, const vertex_t& p2, const vertex_t& p
 
 }
 
-const scalar_t calculate_volume(const model_t& m)
+// (for any precision, see precision.hxx)
+template<typename VST, typename MT>
+inline const scalar_t calculate_volume(const model<VST, MT>& m)
 {
+	INSTRUMENT_TIMER(volume);
 	return std::accumulate(
 		m.mesh().begin(),
 	       	m.mesh().end(),
 		scalar_t(0),
-		[ &m ] (scalar_t vol, const face_t& f)
+		[ &m ] (scalar_t vol, const typename MT::value_type& f)
 		{
 			return vol + signed_volume(
-				m.vertex_set()[f.a()],
-				m.vertex_set()[f.b()],
-				m.vertex_set()[f.c()]);
+				to_vertex(m.vertex_set()[f.a()]),
+				to_vertex(m.vertex_set()[f.b()]),
+				to_vertex(m.vertex_set()[f.c()]));
 		}
 	);
 }
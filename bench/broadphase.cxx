@@ -0,0 +1,76 @@
+// all-pairs loop against sort and sweep and the uniform grid, on random boxes.
+// usage: broadphase [max number of boxes]
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../main/broadphase.hxx"
+
+// n boxes, each 'size' wide (at most) along every axis, in a cube that grows
+// with n (the number of boxes per unit of volume stays the same, as in an
+// assembly with more parts)
+static std::vector<aabb> random_boxes(const size_t n, const scalar_t size, std::mt19937& gen)
+{
+	std::uniform_real_distribution<double> pos(0, 10 * std::cbrt(scalar_t(n)));
+	std::uniform_real_distribution<double> len(0, size);
+	std::vector<aabb> boxes;
+	boxes.reserve(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		const vertex_t mn { { pos(gen), pos(gen), pos(gen) } };
+		const vertex_t mx { { mn.x() + len(gen), mn.y() + len(gen), mn.z() + len(gen) } };
+		boxes.push_back(aabb(range_t(mn, mx)));
+	}
+	return boxes;
+}
+
+template<typename Fn>
+static double time_ms(Fn fn)
+{
+	const auto start = std::chrono::steady_clock::now();
+	fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, const char* argv[])
+{
+	const size_t max_n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+	// the all-pairs loop gets too slow beyond this
+	const size_t max_brute = 20000;
+
+	std::mt19937 gen(42);
+	// the sweep gets too slow beyond this
+	const size_t max_sweep = 100000;
+
+	std::cout << "boxes\tpairs\tall-pairs (ms)\tsweep (ms)\tgrid (ms)\n";
+	for(size_t n = 100; n <= max_n; n *= 10)
+	{
+		const std::vector<aabb> boxes = random_boxes(n, 2, gen);
+
+		std::vector<box_pair_t> grid;
+		const double t_grid = time_ms([ & ] () { grid = overlapping_pairs_grid(boxes); });
+		std::cout << n << "\t" << grid.size();
+
+		for(const auto& method: {
+			std::make_pair(max_brute, overlapping_pairs_brute),
+			std::make_pair(max_sweep, overlapping_pairs_sweep) })
+		{
+			std::cout << "\t";
+			if(n > method.first)
+			{
+				std::cout << "-";
+				continue;
+			}
+			std::vector<box_pair_t> pairs;
+			std::cout << time_ms([ & ] () { pairs = method.second(boxes); });
+			if(pairs != grid)
+			{
+				std::cout << " (MISMATCH)";
+			}
+		}
+		std::cout << "\t" << t_grid << std::endl;
+	}
+}
@@ -0,0 +1,278 @@
+// parsing and the kernels in algo/ and main/bbox.cxx on synthetic meshes of
+// 1K triangles up to the given maximum (in powers of 10), results as JSON on
+// stdout (progress on stderr), to compare runs across commits.
+// usage: kernels [max number of triangles (1000000)] [threads (all)]
+//
+// the meshes:
+// - sphere:   a closed UV sphere, faces after all vertices (absolute indices)
+// - soup:     triangles at random, each with its own vertices
+// - relative: the same soup, every face right after its vertices, with
+//             negative (relative) indices
+// the OBJ text of a mesh is kept in memory (up to 65 bytes per vertex and
+// 30 per face), as well as its model: a soup of 100M triangles takes about
+// 20 GB of text and 10 GB of model.
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../parser/parser.hxx"
+#include "../main/bbox.hxx"
+#include "../main/parallel.hxx"
+#include "../algo/bounding.hxx"
+#include "../algo/surface.hxx"
+#include "../algo/volume.hxx"
+#include "../algo/stats.hxx"
+
+// OBJ text, written without going through streams
+class obj_writer
+{
+private:
+	std::string text;
+
+	void number(const double d)
+	{
+		char buf[32];
+		const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), d);
+		text.append(buf, r.ptr);
+	}
+
+	void number(const long long i)
+	{
+		char buf[32];
+		const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), i);
+		text.append(buf, r.ptr);
+	}
+
+public:
+	void vertex(const double x, const double y, const double z)
+	{
+		text += "v ";
+		number(x);
+		text += ' ';
+		number(y);
+		text += ' ';
+		number(z);
+		text += '\n';
+	}
+
+	void face(const long long a, const long long b, const long long c)
+	{
+		text += "f ";
+		number(a);
+		text += ' ';
+		number(b);
+		text += ' ';
+		number(c);
+		text += '\n';
+	}
+
+	const std::string& str() const { return text; }
+};
+
+// a unit sphere of about n triangles
+static std::string sphere(const size_t n)
+{
+	// r rings of 2 * r segments: 4 * r * (r - 1) triangles
+	const long long r = std::max(2LL, (long long)(std::sqrt(n / 4.0) + 0.5));
+	const long long k = 2 * r;
+	const double pi = std::acos(-1.0);
+
+	obj_writer out;
+	out.vertex(0, 0, 1);
+	for(long long i = 1; i < r; i++)
+	{
+		const double theta = pi * i / r;
+		for(long long j = 0; j < k; j++)
+		{
+			const double phi = 2 * pi * j / k;
+			out.vertex(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+		}
+	}
+	out.vertex(0, 0, -1);
+
+	// (1-based) vertex j of ring i (1 <= i < r)
+	const auto at = [ k ] (const long long i, const long long j) { return 2 + (i - 1) * k + (j % k); };
+	const long long bottom = 2 + (r - 1) * k;
+	for(long long j = 0; j < k; j++)
+	{
+		out.face(1, at(1, j), at(1, j + 1));
+	}
+	for(long long i = 1; i + 1 < r; i++)
+	{
+		for(long long j = 0; j < k; j++)
+		{
+			out.face(at(i, j), at(i + 1, j), at(i + 1, j + 1));
+			out.face(at(i, j), at(i + 1, j + 1), at(i, j + 1));
+		}
+	}
+	for(long long j = 0; j < k; j++)
+	{
+		out.face(at(r - 1, j), bottom, at(r - 1, j + 1));
+	}
+	return out.str();
+}
+
+// n small triangles in the unit cube, each with its own vertices
+static std::string soup(const size_t n, const bool relative, std::mt19937& gen)
+{
+	std::uniform_real_distribution<double> pos(0, 1);
+	std::uniform_real_distribution<double> off(-0.01, 0.01);
+	obj_writer out;
+	std::vector<double> v(9);
+	for(size_t f = 0; f < n; f++)
+	{
+		const double x = pos(gen), y = pos(gen), z = pos(gen);
+		for(int i = 0; i < 3; i++)
+		{
+			v[3 * i] = x + off(gen);
+			v[3 * i + 1] = y + off(gen);
+			v[3 * i + 2] = z + off(gen);
+		}
+		for(int i = 0; i < 3; i++)
+		{
+			out.vertex(v[3 * i], v[3 * i + 1], v[3 * i + 2]);
+		}
+		if(relative)
+		{
+			out.face(-3, -2, -1);
+		}
+	}
+	// (otherwise the faces follow all vertices)
+	if(!relative)
+	{
+		for(size_t f = 0; f < n; f++)
+		{
+			out.face(3 * f + 1, 3 * f + 2, 3 * f + 3);
+		}
+	}
+	return out.str();
+}
+
+// the fastest of a few runs of fn (in ms): at least 3, and more as long
+// as all of them together take less than a second
+template<typename Fn>
+static double time_ms(Fn fn)
+{
+	double best = 0;
+	double total = 0;
+	for(int run = 0; run < 3 || (total < 1000 && run < 100); run++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		const double t = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = run == 0 ? t : std::min(best, t);
+		total += t;
+	}
+	return best;
+}
+
+// keeps results from being optimised away
+static volatile double sink;
+
+static void bench_mesh(
+	const std::string& name,
+	const std::string& text,
+	const unsigned threads,
+	const bool first)
+{
+	const char* f = text.data();
+	const char* l = text.data() + text.size();
+	const double mb = text.size() / 1e6;
+
+	model_t m;
+	const double t_parse = time_ms([ & ] ()
+	{
+		m = std::get<0>(parse(f, l, parse_mode::single_pass, 1));
+	});
+	const double t_parse_mt = time_ms([ & ] ()
+	{
+		m = std::get<0>(parse(f, l, parse_mode::single_pass, threads));
+	});
+
+	const double t_aabb = time_ms([ & ] () { sink = calculate_aabb(m).first.x(); });
+	const double t_surface = time_ms([ & ] () { sink = calculate_surface(m); });
+	const double t_volume = time_ms([ & ] () { sink = calculate_volume(m); });
+	const double t_stats = time_ms([ & ] () { sink = calculate_mesh_stats(m, 1).surface(); });
+	const double t_stats_mt = time_ms([ & ] () { sink = calculate_mesh_stats(m, threads).surface(); });
+
+	std::cout << (first ? "" : ",\n")
+		<< "    { \"mesh\": \"" << name << "\""
+		<< ", \"triangles\": " << m.mesh().size()
+		<< ", \"vertices\": " << m.vertex_set().size()
+		<< ", \"bytes\": " << text.size()
+		<< ", \"parse_mb_s\": " << mb / (t_parse / 1000)
+		<< ", \"parse_mb_s_threads\": " << mb / (t_parse_mt / 1000)
+		<< ", \"aabb_ms\": " << t_aabb
+		<< ", \"surface_ms\": " << t_surface
+		<< ", \"volume_ms\": " << t_volume
+		<< ", \"mesh_stats_ms\": " << t_stats
+		<< ", \"mesh_stats_ms_threads\": " << t_stats_mt
+		<< " }" << std::flush;
+}
+
+// ns per operation of the aabb set operations, on random pairs of boxes
+static void bench_bbox(std::mt19937& gen)
+{
+	const size_t n = 1 << 16;
+	std::uniform_real_distribution<double> pos(0, 10);
+	std::uniform_real_distribution<double> len(0, 3);
+	std::vector<aabb> boxes;
+	boxes.reserve(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		const vertex_t mn { { pos(gen), pos(gen), pos(gen) } };
+		boxes.push_back(aabb(range_t(mn, vertex_t { { mn.x() + len(gen), mn.y() + len(gen), mn.z() + len(gen) } })));
+	}
+
+	const auto per_op = [ & ] (auto op)
+	{
+		return time_ms([ & ] ()
+		{
+			double acc = 0;
+			for(size_t i = 0; i + 1 < n; i++)
+			{
+				acc += op(boxes[i], boxes[i + 1]);
+			}
+			sink = acc;
+		}) * 1e6 / (n - 1);
+	};
+
+	std::cout
+		<< "  \"bbox_ns\": {"
+		<< " \"union\": " << per_op([] (const aabb& a, const aabb& b) { return (a | b).min_x(); })
+		<< ", \"union_assign\": " << per_op([] (aabb a, const aabb& b) { return (a |= b).min_x(); })
+		<< ", \"intersection\": " << per_op([] (const aabb& a, const aabb& b) { return (a & b).min_x(); })
+		<< ", \"intersects\": " << per_op([] (const aabb& a, const aabb& b) { return double(a && b); })
+		<< ", \"contains\": " << per_op([] (const aabb& a, const aabb& b) { return double(a >= b); })
+		<< ", \"equals\": " << per_op([] (const aabb& a, const aabb& b) { return double(a == b); })
+		<< ", \"surface\": " << per_op([] (const aabb& a, const aabb&) { return a.surface(); })
+		<< ", \"volume\": " << per_op([] (const aabb& a, const aabb&) { return a.volume(); })
+		<< " }";
+}
+
+int main(int argc, const char* argv[])
+{
+	const size_t max_n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+	const unsigned threads = argc > 2 ? std::max(1u, unsigned(std::strtoul(argv[2], nullptr, 10))) : default_threads();
+
+	std::mt19937 gen(42);
+	std::cout << "{\n  \"threads\": " << threads << ",\n";
+	bench_bbox(gen);
+	std::cout << ",\n  \"meshes\": [\n";
+	bool first = true;
+	for(size_t n = 1000; n <= max_n; n *= 10)
+	{
+		std::cerr << n << " triangles\n";
+		bench_mesh("sphere", sphere(n), threads, first);
+		first = false;
+		bench_mesh("soup", soup(n, false, gen), threads, first);
+		bench_mesh("relative", soup(n, true, gen), threads, first);
+	}
+	std::cout << "\n  ]\n}\n";
+}
@@ -18,7 +18,7 @@ aabb::aabb(const aabb& box)
 aabb::~aabb() {}
 
 const aabb& aabb::operator=(const aabb& box)
-{ data = box.data; }
+{ data = box.data; return *this; }
 
 const bool aabb::operator==(const aabb& box) const
 { return box.data == data; }
@@ -101,22 +101,30 @@ const bool aabb::operator||(const aabb& box) const
 { return !(*this && box); }
 
 const aabb aabb::operator|(const aabb& box) const
-{ return aabb( { min(), max(), box.min(), box.max() } ); }
+{ return aabb(*this) |= box; }
 
 const aabb aabb::operator|(const vertex_t& v) const
-{ return aabb( { min(), max(), v } ); }
+{ return aabb(*this) |= v; }
 
 const aabb aabb::operator|(const vertex_set_t& vs) const
-{ return *this | aabb(vs); }
+{ return aabb(*this) |= vs; }
 
 const aabb& aabb::operator|=(const aabb& box)
-{ *this = (*this | box); return *this; }
+{
+	data.first = data.first.min(box.min());
+	data.second = data.second.max(box.max());
+	return *this;
+}
 
 const aabb& aabb::operator|=(const vertex_t& v)
-{ *this = (*this | v); return *this; }
+{
+	data.first = data.first.min(v);
+	data.second = data.second.max(v);
+	return *this;
+}
 
 const aabb& aabb::operator|=(const vertex_set_t& vs)
-{ *this = (*this | vs); return *this; }
+{ return *this |= aabb(vs); }
 
 const aabb aabb::operator&(const aabb& box) const
 {
@@ -176,10 +184,8 @@ inline bool aabb::does_axis_int(
 	const coord_t& max,
 	const coord_t& bmax)
 {
-	return (bmin > min && bmin < max)
-		|| (bmax > min && bmax < max)
-		|| (min > bmin && min < bmax)
-		|| (max > bmin && max < bmax); 
+	// the open intervals (min, max) and (bmin, bmax) overlap
+	return bmin < max && min < bmax;
 }
 
 const scalar_t aabb::len_x() const
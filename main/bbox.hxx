@@ -12,15 +12,17 @@ class aabb // axis-aligned bounding box
 private:
 	range_t data;
 
-	aabb(const range_t& range);
-
 	inline static bool does_axis_int(
 		const coord_t& min,
 		const coord_t& bmin,
 		const coord_t& max,
 		const coord_t& bmax);
 public:
+	aabb(const range_t& range);
 	aabb(const model_t& mod);
+	// the box of a model of any precision (see precision.hxx) is kept in double
+	template<typename VST, typename MT>
+	aabb(const model<VST, MT>& mod) : data(calculate_aabb(mod)) {}
 	aabb(const vertex_set_t& vertex_set);
 	aabb(std::initializer_list<vertex_t>& list);
 	aabb(const aabb& box);
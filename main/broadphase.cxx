@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include "broadphase.hxx"
+
+// up to this number of boxes overlapping_pairs() sweeps
+static const size_t sweep_max = 1024;
+// boxes covering more cells than this are tested against all other boxes
+static const size_t grid_max_cells = 64;
+// bits per axis of a cell's key
+static const int grid_bits = 21;
+
+static inline const coord_t lower(const aabb& box, const int axis)
+{ return axis == 0 ? box.min_x() : (axis == 1 ? box.min_y() : box.min_z()); }
+
+static inline const coord_t upper(const aabb& box, const int axis)
+{ return axis == 0 ? box.max_x() : (axis == 1 ? box.max_y() : box.max_z()); }
+
+// the axis along which the centres of the boxes vary the most
+static int sweep_axis(const std::vector<aabb>& boxes)
+{
+	scalar_t sum[3] = { 0, 0, 0 };
+	scalar_t sq[3] = { 0, 0, 0 };
+	size_t n = 0;
+	for(const aabb& box: boxes)
+	{
+		if(!std::isfinite(box.min_x() + box.max_x() + box.min_y() + box.max_y() + box.min_z() + box.max_z()))
+		{
+			continue;
+		}
+		n++;
+		for(int a = 0; a < 3; a++)
+		{
+			const scalar_t c = (lower(box, a) + upper(box, a)) / 2;
+			sum[a] += c;
+			sq[a] += c * c;
+		}
+	}
+	int best = 0;
+	scalar_t best_var = -1;
+	for(int a = 0; a < 3 && n > 0; a++)
+	{
+		const scalar_t var = sq[a] / n - (sum[a] / n) * (sum[a] / n);
+		if(var > best_var)
+		{
+			best_var = var;
+			best = a;
+		}
+	}
+	return best;
+}
+
+std::vector<box_pair_t> overlapping_pairs(const std::vector<aabb>& boxes)
+{
+	return boxes.size() <= sweep_max
+		? overlapping_pairs_sweep(boxes)
+		: overlapping_pairs_grid(boxes);
+}
+
+std::vector<box_pair_t> overlapping_pairs_sweep(const std::vector<aabb>& boxes)
+{
+	const int axis = sweep_axis(boxes);
+
+	std::vector<index_t> order(boxes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [ &boxes, axis ] (const index_t a, const index_t b)
+	{
+		return lower(boxes[a], axis) < lower(boxes[b], axis)
+			|| (lower(boxes[a], axis) == lower(boxes[b], axis) && a < b);
+	});
+
+	// boxes that may still intersect the ones to come: a box is done once
+	// the sweep reaches its maximum (boxes that only touch do not intersect)
+	std::vector<box_pair_t> pairs;
+	std::vector<index_t> active;
+	for(const index_t j: order)
+	{
+		const coord_t at = lower(boxes[j], axis);
+		for(size_t k = 0; k < active.size(); )
+		{
+			const index_t i = active[k];
+			if(upper(boxes[i], axis) <= at)
+			{
+				active[k] = active.back();
+				active.pop_back();
+				continue;
+			}
+			if(boxes[i] && boxes[j])
+			{
+				pairs.push_back(box_pair_t(std::min(i, j), std::max(i, j)));
+			}
+			k++;
+		}
+		active.push_back(j);
+	}
+
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+// cells of a uniform grid
+struct grid
+{
+	coord_t origin[3];
+	coord_t cell;
+
+	const uint64_t index(const coord_t c, const int axis) const
+	{
+		const coord_t i = std::floor((c - origin[axis]) / cell);
+		return uint64_t(std::min<coord_t>(std::max<coord_t>(i, 0), (uint64_t(1) << grid_bits) - 1));
+	}
+
+	const uint64_t key(const uint64_t x, const uint64_t y, const uint64_t z) const
+	{ return (((x << grid_bits) | y) << grid_bits) | z; }
+};
+
+// a regular box: finite, with min <= max
+static inline const bool regular(const aabb& box)
+{
+	for(int a = 0; a < 3; a++)
+	{
+		if(!(std::isfinite(lower(box, a)) && std::isfinite(upper(box, a)) && lower(box, a) <= upper(box, a)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<box_pair_t> overlapping_pairs_grid(const std::vector<aabb>& boxes)
+{
+	// the cells are as large as the boxes are on average (but there are
+	// no more than 2^grid_bits along an axis)
+	std::vector<char> big(boxes.size(), 0);
+	grid g;
+	coord_t hi[3];
+	for(int a = 0; a < 3; a++)
+	{
+		g.origin[a] = std::numeric_limits<coord_t>::infinity();
+		hi[a] = -std::numeric_limits<coord_t>::infinity();
+	}
+	scalar_t extent = 0;
+	size_t n = 0;
+	for(index_t i = 0; i < boxes.size(); i++)
+	{
+		if(!regular(boxes[i]))
+		{
+			big[i] = 1;
+			continue;
+		}
+		n++;
+		scalar_t e = 0;
+		for(int a = 0; a < 3; a++)
+		{
+			g.origin[a] = std::min(g.origin[a], lower(boxes[i], a));
+			hi[a] = std::max(hi[a], upper(boxes[i], a));
+			e = std::max(e, upper(boxes[i], a) - lower(boxes[i], a));
+		}
+		extent += e;
+	}
+	scalar_t scene = 0;
+	for(int a = 0; a < 3 && n > 0; a++)
+	{
+		scene = std::max(scene, hi[a] - g.origin[a]);
+	}
+	g.cell = std::max(n > 0 ? extent / n : 0, scene / (uint64_t(1) << (grid_bits - 1)));
+	if(!(g.cell > 0))
+	{
+		g.cell = 1;
+	}
+
+	// (cell, box) for every cell a box covers
+	std::vector<std::pair<uint64_t, index_t>> cells;
+	cells.reserve(n * 2);
+	for(index_t i = 0; i < boxes.size(); i++)
+	{
+		if(big[i])
+		{
+			continue;
+		}
+		const aabb& box = boxes[i];
+		const uint64_t x0 = g.index(box.min_x(), 0), x1 = g.index(box.max_x(), 0);
+		const uint64_t y0 = g.index(box.min_y(), 1), y1 = g.index(box.max_y(), 1);
+		const uint64_t z0 = g.index(box.min_z(), 2), z1 = g.index(box.max_z(), 2);
+		if((x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1) > grid_max_cells)
+		{
+			big[i] = 1;
+			continue;
+		}
+		for(uint64_t x = x0; x <= x1; x++)
+		{
+			for(uint64_t y = y0; y <= y1; y++)
+			{
+				for(uint64_t z = z0; z <= z1; z++)
+				{
+					cells.push_back(std::make_pair(g.key(x, y, z), i));
+				}
+			}
+		}
+	}
+	std::sort(cells.begin(), cells.end());
+
+	std::vector<box_pair_t> pairs;
+	for(size_t b = 0; b < cells.size(); )
+	{
+		size_t e = b + 1;
+		for(; e < cells.size() && cells[e].first == cells[b].first; e++);
+		for(size_t k = b; k < e; k++)
+		{
+			const aabb& bi = boxes[cells[k].second];
+			for(size_t l = k + 1; l < e; l++)
+			{
+				const aabb& bj = boxes[cells[l].second];
+				if(!(bi && bj))
+				{
+					continue;
+				}
+				// only in the cell of the minimum of the intersection
+				const uint64_t owner = g.key(
+					g.index(std::max(bi.min_x(), bj.min_x()), 0),
+					g.index(std::max(bi.min_y(), bj.min_y()), 1),
+					g.index(std::max(bi.min_z(), bj.min_z()), 2));
+				if(owner == cells[b].first)
+				{
+					pairs.push_back(box_pair_t(cells[k].second, cells[l].second));
+				}
+			}
+		}
+		b = e;
+	}
+
+	// the rest against everything
+	for(index_t i = 0; i < boxes.size(); i++)
+	{
+		if(!big[i])
+		{
+			continue;
+		}
+		for(index_t j = 0; j < boxes.size(); j++)
+		{
+			if(j != i && !(big[j] && j < i) && (boxes[i] && boxes[j]))
+			{
+				pairs.push_back(box_pair_t(std::min(i, j), std::max(i, j)));
+			}
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+std::vector<box_pair_t> overlapping_pairs_brute(const std::vector<aabb>& boxes)
+{
+	std::vector<box_pair_t> pairs;
+	for(index_t i = 0; i < boxes.size(); i++)
+	{
+		for(index_t j = i + 1; j < boxes.size(); j++)
+		{
+			if(boxes[i] && boxes[j])
+			{
+				pairs.push_back(box_pair_t(i, j));
+			}
+		}
+	}
+	return pairs;
+}
@@ -0,0 +1,37 @@
+#ifndef BROADPHASE_HEADER_FILE
+#define BROADPHASE_HEADER_FILE
+
+#include <utility>
+#include <vector>
+
+#include "types.hxx"
+#include "bbox.hxx"
+
+///////////////////////////////////////////
+//              broad phase              //
+///////////////////////////////////////////
+
+// (indices of) two boxes, first < second
+typedef std::pair<index_t, index_t>				box_pair_t;
+
+// all pairs of intersecting boxes (a && b), sorted.
+// picks one of the methods below (the sweep for a handful of boxes)
+std::vector<box_pair_t> overlapping_pairs(const std::vector<aabb>& boxes);
+
+// sort and sweep: the boxes are sorted on their minimum along the axis on which
+// they are spread the most; while sweeping, only boxes that are still open on
+// that axis are tested against the next one. fine as long as few boxes overlap
+// on the sweep axis, but in a 3D scene that grows evenly that is n^(2/3) boxes.
+std::vector<box_pair_t> overlapping_pairs_sweep(const std::vector<aabb>& boxes);
+
+// uniform grid: every box goes into the cells it covers (cells are about as
+// large as the boxes), only boxes in the same cell are tested. a pair is
+// reported by the cell that holds the minimum of its intersection. boxes that
+// cover too many cells are tested against all others.
+// O(n log n + number of pairs) for boxes of similar size.
+std::vector<box_pair_t> overlapping_pairs_grid(const std::vector<aabb>& boxes);
+
+// the same, testing every pair of boxes (O(n^2))
+std::vector<box_pair_t> overlapping_pairs_brute(const std::vector<aabb>& boxes);
+
+#endif // BROADPHASE_HEADER_FILE
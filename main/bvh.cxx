@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include "bvh.hxx"
+
+// faces per block of work when computing the boxes of the faces
+static const size_t bvh_block = size_t(1) << 14;
+// below this number of faces a subtree is built by one thread
+static const size_t bvh_parallel_min = size_t(1) << 12;
+
+struct bvh::build_data
+{
+	std::vector<range_t> boxes;
+	std::vector<vertex_t> centroids;
+};
+
+static inline const range_t empty_range()
+{
+	return range_t(
+		vertex_t(std::numeric_limits<coord_t>::infinity()),
+		vertex_t(-std::numeric_limits<coord_t>::infinity()));
+}
+
+static inline void grow(range_t& r, const range_t& o)
+{
+	r.first = r.first.min(o.first);
+	r.second = r.second.max(o.second);
+}
+
+static inline void grow(range_t& r, const vertex_t& v)
+{
+	r.first = r.first.min(v);
+	r.second = r.second.max(v);
+}
+
+static inline const scalar_t half_area(const range_t& r)
+{
+	const vertex_t d = r.first.to(r.second);
+	return d.x() * d.y() + d.x() * d.z() + d.y() * d.z();
+}
+
+static inline const coord_t axis(const vertex_t& v, const int a)
+{ return a == 0 ? v.x() : (a == 1 ? v.y() : v.z()); }
+
+static inline const scalar_t dot(const vertex_t& u, const vertex_t& v)
+{ return u.x() * v.x() + u.y() * v.y() + u.z() * v.z(); }
+
+// closed overlap of two boxes
+static inline const bool touches(const range_t& r, const aabb& box)
+{
+	return r.first.x() <= box.max_x() && box.min_x() <= r.second.x()
+		&& r.first.y() <= box.max_y() && box.min_y() <= r.second.y()
+		&& r.first.z() <= box.max_z() && box.min_z() <= r.second.z();
+}
+
+// slab test: does the ray enter box before t_max (and after 0)
+// (NaN's, from a zero direction on a slab's plane, count as a hit)
+static inline const bool ray_box(
+	const range_t& r,
+	const vertex_t& origin,
+	const vertex_t& inv,
+	const scalar_t t_max)
+{
+	scalar_t t_in = 0;
+	scalar_t t_out = t_max;
+	for(int a = 0; a < 3; a++)
+	{
+		scalar_t t1 = (axis(r.first, a) - axis(origin, a)) * axis(inv, a);
+		scalar_t t2 = (axis(r.second, a) - axis(origin, a)) * axis(inv, a);
+		if(t1 > t2)
+		{
+			std::swap(t1, t2);
+		}
+		if(t1 > t_in)
+		{
+			t_in = t1;
+		}
+		if(t2 < t_out)
+		{
+			t_out = t2;
+		}
+	}
+	return t_in <= t_out;
+}
+
+bvh::bvh(const model_t& m, const unsigned threads)
+: mod(m)
+{
+	const vertex_set_t& vs = mod.vertex_set();
+	const mesh_t& mesh = mod.mesh();
+	if(mesh.empty())
+	{
+		return;
+	}
+
+	build_data bd;
+	bd.boxes.resize(mesh.size(), empty_range());
+	bd.centroids.resize(mesh.size(), vertex_t(0));
+	order.resize(mesh.size());
+	parallel_for((mesh.size() + bvh_block - 1) / bvh_block, threads, [ & ] (const size_t b)
+	{
+		for(index_t i = b * bvh_block; i < std::min(mesh.size(), (b + 1) * bvh_block); i++)
+		{
+			const face_t& f = mesh[i];
+			range_t& r = bd.boxes[i];
+			grow(r, vs[f.a()]);
+			grow(r, vs[f.b()]);
+			grow(r, vs[f.c()]);
+			bd.centroids[i] = vertex_t(std::make_tuple(
+				(r.first.x() + r.second.x()) / 2,
+				(r.first.y() + r.second.y()) / 2,
+				(r.first.z() + r.second.z()) / 2));
+			order[i] = i;
+		}
+	});
+
+	tree.reserve(2 * mesh.size() / max_leaf + 1);
+	build_parallel(bd, 0, mesh.size(), threads, tree);
+}
+
+std::tuple<range_t, size_t> bvh::split(const build_data& bd, const size_t b, const size_t e)
+{
+	range_t box = empty_range();
+	range_t cbox = empty_range();
+	for(size_t i = b; i < e; i++)
+	{
+		grow(box, bd.boxes[order[i]]);
+		grow(cbox, bd.centroids[order[i]]);
+	}
+
+	const size_t n = e - b;
+	if(n == 1)
+	{
+		return std::make_tuple(box, e);
+	}
+
+	// binned SAH: for each axis put the centroids in bins, the cost of a
+	// split between bins is n_left * area_left + n_right * area_right
+	int best_axis = -1;
+	unsigned best_bin = 0;
+	scalar_t best_cost = std::numeric_limits<scalar_t>::infinity();
+	for(int a = 0; a < 3; a++)
+	{
+		const coord_t lo = axis(cbox.first, a);
+		const coord_t extent = axis(cbox.second, a) - lo;
+		if(!(extent > 0))
+		{
+			continue;
+		}
+
+		size_t count[bins] = { };
+		std::vector<range_t> bin_box(bins, empty_range());
+		for(size_t i = b; i < e; i++)
+		{
+			const unsigned k = std::min<unsigned>(bins - 1,
+				unsigned(bins * ((axis(bd.centroids[order[i]], a) - lo) / extent)));
+			count[k]++;
+			grow(bin_box[k], bd.boxes[order[i]]);
+		}
+
+		// sweep from the right, then from the left
+		scalar_t right_cost[bins];
+		range_t acc = empty_range();
+		size_t acc_n = 0;
+		for(unsigned k = bins - 1; k > 0; k--)
+		{
+			grow(acc, bin_box[k]);
+			acc_n += count[k];
+			right_cost[k] = acc_n ? acc_n * half_area(acc) : 0;
+		}
+		acc = empty_range();
+		acc_n = 0;
+		for(unsigned k = 1; k < bins; k++)
+		{
+			grow(acc, bin_box[k - 1]);
+			acc_n += count[k - 1];
+			if(acc_n == 0 || acc_n == n)
+			{
+				continue;
+			}
+			const scalar_t cost = acc_n * half_area(acc) + right_cost[k];
+			if(cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = a;
+				best_bin = k;
+			}
+		}
+	}
+
+	// a leaf when that's cheaper (traversing a node costs as much as a
+	// face), but never a big one
+	const scalar_t area = half_area(box);
+	const bool no_split = best_axis < 0;
+	if(n <= max_leaf && (no_split || area <= 0 || n <= 1 + best_cost / area))
+	{
+		return std::make_tuple(box, e);
+	}
+
+	index_t* const first = &order[0];
+	if(no_split)
+	{
+		// all centroids coincide: any split is as good
+		return std::make_tuple(box, b + n / 2);
+	}
+
+	const coord_t lo = axis(cbox.first, best_axis);
+	const coord_t extent = axis(cbox.second, best_axis) - lo;
+	const index_t* mid = std::partition(first + b, first + e, [ & ] (const index_t f)
+	{
+		return std::min<unsigned>(bins - 1,
+			unsigned(bins * ((axis(bd.centroids[f], best_axis) - lo) / extent))) < best_bin;
+	});
+	return std::make_tuple(box, size_t(mid - first));
+}
+
+void bvh::build_serial(build_data& bd, const size_t b, const size_t e, std::vector<node>& out)
+{
+	const size_t me = out.size();
+	range_t box = empty_range();
+	size_t mid = e;
+	std::tie(box, mid) = split(bd, b, e);
+	out.push_back( { aabb(box), uint32_t(b), uint32_t(e - b) } );
+	if(mid == e)
+	{
+		return;
+	}
+	out[me].count = 0;
+	build_serial(bd, b, mid, out);
+	out[me].offset = uint32_t(out.size());
+	build_serial(bd, mid, e, out);
+}
+
+void bvh::build_parallel(
+	build_data& bd,
+	const size_t b,
+	const size_t e,
+	const unsigned threads,
+	std::vector<node>& out)
+{
+	if(threads <= 1 || e - b < bvh_parallel_min)
+	{
+		build_serial(bd, b, e, out);
+		return;
+	}
+
+	const size_t me = out.size();
+	range_t box = empty_range();
+	size_t mid = e;
+	std::tie(box, mid) = split(bd, b, e);
+	out.push_back( { aabb(box), uint32_t(b), uint32_t(e - b) } );
+	if(mid == e)
+	{
+		return;
+	}
+	out[me].count = 0;
+
+	// both halves on their own, then appended (moving their inner nodes)
+	std::vector<node> left;
+	std::vector<node> right;
+	std::thread t([ & ] () { build_parallel(bd, b, mid, threads / 2, left); });
+	build_parallel(bd, mid, e, threads - threads / 2, right);
+	t.join();
+
+	for(std::vector<node>* sub: { &left, &right })
+	{
+		const uint32_t base = uint32_t(out.size());
+		if(sub == &right)
+		{
+			out[me].offset = base;
+		}
+		for(node& nd: *sub)
+		{
+			if(!nd.leaf())
+			{
+				nd.offset += base;
+			}
+			out.push_back(nd);
+		}
+	}
+}
+
+const model_t& bvh::source() const
+{ return mod; }
+
+const std::vector<bvh::node>& bvh::nodes() const
+{ return tree; }
+
+const std::vector<index_t>& bvh::faces() const
+{ return order; }
+
+std::vector<index_t> bvh::overlapping(const aabb& box) const
+{
+	std::vector<index_t> res;
+	if(tree.empty())
+	{
+		return res;
+	}
+
+	const vertex_set_t& vs = mod.vertex_set();
+	std::vector<uint32_t> stack(1, 0);
+	while(!stack.empty())
+	{
+		const node& nd = tree[stack.back()];
+		const uint32_t cur = stack.back();
+		stack.pop_back();
+		if(!touches(nd.box.range(), box))
+		{
+			continue;
+		}
+		if(!nd.leaf())
+		{
+			stack.push_back(nd.offset);
+			stack.push_back(cur + 1);
+			continue;
+		}
+		for(size_t i = nd.offset; i < nd.offset + nd.count; i++)
+		{
+			const face_t& f = mod.mesh()[order[i]];
+			if(overlaps(vs[f.a()], vs[f.b()], vs[f.c()], box))
+			{
+				res.push_back(order[i]);
+			}
+		}
+	}
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+template<typename Fn>
+void bvh::traverse_ray(const vertex_t& origin, const vertex_t& dir, scalar_t& t_max, Fn fn) const
+{
+	if(tree.empty())
+	{
+		return;
+	}
+
+	const vertex_t inv(std::make_tuple(1 / dir.x(), 1 / dir.y(), 1 / dir.z()));
+	std::vector<uint32_t> stack(1, 0);
+	while(!stack.empty())
+	{
+		const uint32_t cur = stack.back();
+		const node& nd = tree[cur];
+		stack.pop_back();
+		if(!ray_box(nd.box.range(), origin, inv, t_max))
+		{
+			continue;
+		}
+		if(!nd.leaf())
+		{
+			stack.push_back(nd.offset);
+			stack.push_back(cur + 1);
+			continue;
+		}
+		for(size_t i = nd.offset; i < nd.offset + nd.count; i++)
+		{
+			fn(order[i]);
+		}
+	}
+}
+
+std::tuple<bool, index_t, scalar_t> bvh::ray_cast(const vertex_t& origin, const vertex_t& dir) const
+{
+	const vertex_set_t& vs = mod.vertex_set();
+	bool hit = false;
+	index_t face = 0;
+	scalar_t t_max = std::numeric_limits<scalar_t>::infinity();
+	traverse_ray(origin, dir, t_max, [ & ] (const index_t i)
+	{
+		const face_t& f = mod.mesh()[i];
+		bool h = false;
+		scalar_t t = 0;
+		std::tie(h, t) = intersect(vs[f.a()], vs[f.b()], vs[f.c()], origin, dir);
+		// (the lowest index wins a tie, whatever the layout of the tree)
+		if(h && (t < t_max || (t == t_max && i < face)))
+		{
+			hit = true;
+			face = i;
+			t_max = t;
+		}
+	});
+	return std::make_tuple(hit, face, t_max);
+}
+
+size_t bvh::crossings(const vertex_t& origin, const vertex_t& dir) const
+{
+	const vertex_set_t& vs = mod.vertex_set();
+	size_t n = 0;
+	scalar_t t_max = std::numeric_limits<scalar_t>::infinity();
+	traverse_ray(origin, dir, t_max, [ & ] (const index_t i)
+	{
+		const face_t& f = mod.mesh()[i];
+		n += std::get<0>(intersect(vs[f.a()], vs[f.b()], vs[f.c()], origin, dir));
+	});
+	return n;
+}
+
+const bool bvh::inside(const vertex_t& p) const
+{
+	static const vertex_t dirs[3] = {
+		vertex_t(std::make_tuple(0.3165, 0.8274, 0.4642)),
+		vertex_t(std::make_tuple(-0.7071, 0.3029, 0.6389)),
+		vertex_t(std::make_tuple(0.1883, -0.4472, -0.8745))
+	};
+	int votes = 0;
+	for(const vertex_t& d: dirs)
+	{
+		votes += crossings(p, d) % 2;
+	}
+	return votes >= 2;
+}
+
+const bool bvh::overlaps(const vertex_t& a, const vertex_t& b, const vertex_t& c, const aabb& box)
+{
+	// everything relative to the centre of the box
+	const vertex_t centre(std::make_tuple(
+		(box.min_x() + box.max_x()) / 2,
+		(box.min_y() + box.max_y()) / 2,
+		(box.min_z() + box.max_z()) / 2));
+	const vertex_t h(std::make_tuple(box.len_x() / 2, box.len_y() / 2, box.len_z() / 2));
+	const vertex_t v[3] = { centre.to(a), centre.to(b), centre.to(c) };
+
+	// the axes of the box
+	for(int k = 0; k < 3; k++)
+	{
+		const coord_t lo = std::min( { axis(v[0], k), axis(v[1], k), axis(v[2], k) } );
+		const coord_t hi = std::max( { axis(v[0], k), axis(v[1], k), axis(v[2], k) } );
+		if(lo > axis(h, k) || hi < -axis(h, k))
+		{
+			return false;
+		}
+	}
+
+	// the normal of the triangle
+	const vertex_t e[3] = { v[0].to(v[1]), v[1].to(v[2]), v[2].to(v[0]) };
+	const vertex_t n = e[0].cross(e[1]);
+	const scalar_t r = h.x() * std::abs(n.x()) + h.y() * std::abs(n.y()) + h.z() * std::abs(n.z());
+	if(std::abs(dot(n, v[0])) > r)
+	{
+		return false;
+	}
+
+	// edge x axis of the box
+	const vertex_t units[3] = {
+		vertex_t(std::make_tuple(1., 0., 0.)),
+		vertex_t(std::make_tuple(0., 1., 0.)),
+		vertex_t(std::make_tuple(0., 0., 1.))
+	};
+	for(const vertex_t& edge: e)
+	{
+		for(const vertex_t& u: units)
+		{
+			const vertex_t ax = edge.cross(u);
+			const scalar_t p0 = dot(ax, v[0]);
+			const scalar_t p1 = dot(ax, v[1]);
+			const scalar_t p2 = dot(ax, v[2]);
+			const scalar_t rad = h.x() * std::abs(ax.x()) + h.y() * std::abs(ax.y()) + h.z() * std::abs(ax.z());
+			if(std::min( { p0, p1, p2 } ) > rad || std::max( { p0, p1, p2 } ) < -rad)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::tuple<bool, scalar_t> bvh::intersect(
+	const vertex_t& a, const vertex_t& b, const vertex_t& c,
+	const vertex_t& origin, const vertex_t& dir)
+{
+	const vertex_t e1 = a.to(b);
+	const vertex_t e2 = a.to(c);
+	const vertex_t p = dir.cross(e2);
+	const scalar_t det = dot(e1, p);
+	if(det == 0)
+	{
+		return std::make_tuple(false, scalar_t(0));
+	}
+	const scalar_t inv = 1 / det;
+	const vertex_t s = a.to(origin);
+	const scalar_t u = dot(s, p) * inv;
+	if(u < 0 || u > 1)
+	{
+		return std::make_tuple(false, scalar_t(0));
+	}
+	const vertex_t q = s.cross(e1);
+	const scalar_t v = dot(dir, q) * inv;
+	if(v < 0 || u + v > 1)
+	{
+		return std::make_tuple(false, scalar_t(0));
+	}
+	const scalar_t t = dot(e2, q) * inv;
+	return std::make_tuple(t > 0, t);
+}
@@ -0,0 +1,84 @@
+#ifndef BVH_HEADER_FILE
+#define BVH_HEADER_FILE
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "types.hxx"
+#include "bbox.hxx"
+#include "parallel.hxx"
+
+// bounding volume hierarchy over the faces of a model
+//
+// Built top-down from the aabb's of the faces with a binned SAH (surface area
+// heuristic), the upper levels in parallel. The tree is stored as one flat
+// array of nodes in depth-first order: the left child of an inner node is the
+// next node, its right child is at 'offset'. The faces of a leaf are
+// faces()[offset, offset + count). The tree does not depend on the number of
+// threads used to build it.
+//
+// The model is not copied: it has to outlive the bvh (and must not change).
+class bvh
+{
+public:
+	struct node
+	{
+		aabb box;
+		uint32_t offset; // right child (inner node) or first face (leaf)
+		uint32_t count;  // number of faces, 0 for an inner node
+
+		const bool leaf() const { return count != 0; }
+	};
+
+	static const unsigned bins = 16;
+	static const unsigned max_leaf = 4;
+
+private:
+	const model_t& mod;
+	std::vector<node> tree;
+	std::vector<index_t> order;
+
+	struct build_data;
+
+	// box of the faces [b, e) and where to split them (e: make a leaf)
+	std::tuple<range_t, size_t> split(const build_data& bd, const size_t b, const size_t e);
+	void build_serial(build_data& bd, const size_t b, const size_t e, std::vector<node>& out);
+	void build_parallel(build_data& bd, const size_t b, const size_t e, const unsigned threads, std::vector<node>& out);
+
+	template<typename Fn>
+	void traverse_ray(const vertex_t& origin, const vertex_t& dir, scalar_t& t_max, Fn fn) const;
+
+public:
+	bvh(const model_t& m, const unsigned threads = default_threads());
+
+	const model_t& source() const;
+	const std::vector<node>& nodes() const;
+	// faces in the order of the leaves
+	const std::vector<index_t>& faces() const;
+
+	// (indices of) all faces with a point in box (boundary included)
+	std::vector<index_t> overlapping(const aabb& box) const;
+
+	// nearest face hit by the ray origin + t * dir (t > 0):
+	// (hit, face, t)
+	std::tuple<bool, index_t, scalar_t> ray_cast(const vertex_t& origin, const vertex_t& dir) const;
+
+	// number of faces crossed by the ray origin + t * dir (t > 0)
+	size_t crossings(const vertex_t& origin, const vertex_t& dir) const;
+
+	// is p inside the (closed) mesh: parity of crossings, the majority of
+	// three rays in different directions decides (against rays through
+	// edges and vertices)
+	const bool inside(const vertex_t& p) const;
+
+	// exact triangle - box overlap (separating axis theorem)
+	static const bool overlaps(const vertex_t& a, const vertex_t& b, const vertex_t& c, const aabb& box);
+
+	// ray - triangle intersection (Moller-Trumbore): (hit, t)
+	static std::tuple<bool, scalar_t> intersect(
+		const vertex_t& a, const vertex_t& b, const vertex_t& c,
+		const vertex_t& origin, const vertex_t& dir);
+};
+
+#endif // BVH_HEADER_FILE
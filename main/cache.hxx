@@ -0,0 +1,305 @@
+#ifndef CACHE_HEADER_FILE
+#define CACHE_HEADER_FILE
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "types.hxx"
+#include "../parser/mapped_file.hxx"
+#include "../algo/stats.hxx"
+
+///////////////////////////////////////////
+//          binary model cache           //
+///////////////////////////////////////////
+
+// A cache file holds a cache_header, the vertex array and the face array
+// (both as they are in memory, starting at a multiple of 64 bytes), so
+// loading one is mapping it: the arrays are used in place.
+// The header also keeps the aabb, surface and volume of the model and what
+// the cache was made from (size, mtime and hash of the OBJ file).
+// A cache is only read back by a binary with the same layout of vertex_t
+// and face_t (checked through their size and the bytes of a known vertex
+// and face), otherwise it is ignored.
+
+// what a cache was made from
+struct cache_source
+{
+	uint64_t size;
+	int64_t mtime;
+	uint64_t hash;
+};
+
+struct cache_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t vertex_size;
+	uint32_t face_size;
+	unsigned char vertex_probe[32];
+	unsigned char face_probe[32];
+	uint64_t vertices;
+	uint64_t faces;
+	uint64_t vertex_offset;
+	uint64_t face_offset;
+	uint64_t file_size;
+	cache_source source;
+	scalar_t box[6];
+	scalar_t surface;
+	scalar_t volume;
+	uint32_t syntax;
+	uint32_t semantics;
+};
+
+const char cache_magic[8] = { 'O', 'B', 'J', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t cache_version = 1;
+
+// a model whose arrays are somewhere else (in a cache)
+typedef model<array_view<vertex_t>, array_view<face_t>>	model_view_t;
+
+// FNV-1a, on 64-bit words (and the remaining bytes one by one)
+inline uint64_t hash_bytes(const char* f, const char* l)
+{
+	const uint64_t prime = 0x100000001b3ull;
+	uint64_t h = 0xcbf29ce484222325ull;
+	for(; l - f >= 8; f += 8)
+	{
+		uint64_t w;
+		std::memcpy(&w, f, 8);
+		h = (h ^ w) * prime;
+	}
+	for(; f != l; f++)
+	{
+		h = (h ^ uint64_t(static_cast<unsigned char>(*f))) * prime;
+	}
+	return h;
+}
+
+// mtime of the file at path (std::filesystem has sub-second resolution,
+// boost::filesystem only has seconds), 0 if it can't be determined
+inline int64_t source_mtime(const std::string& path)
+{
+	std::error_code ec;
+	const auto t = std::filesystem::last_write_time(path, ec);
+	return ec ? 0 : int64_t(t.time_since_epoch().count());
+}
+
+// the size and mtime of the file at path, the hash of its contents [f, l)
+inline cache_source describe_source(const std::string& path, const char* f, const char* l)
+{
+	return cache_source { uint64_t(l - f), source_mtime(path), hash_bytes(f, l) };
+}
+
+// where the cache of source goes: next to it, or in dir (the name then
+// includes a hash of the full path of source: files with the same name
+// in different directories don't share a cache)
+inline std::string cache_path(const std::string& source, const std::string& dir = "")
+{
+	if(dir.empty())
+	{
+		return source + ".cache";
+	}
+	const std::string full = boost::filesystem::absolute(source).string();
+	std::ostringstream name;
+	name << boost::filesystem::path(source).filename().string()
+		<< "." << std::hex << std::setw(16) << std::setfill('0')
+		<< hash_bytes(full.data(), full.data() + full.size())
+		<< ".cache";
+	return (boost::filesystem::path(dir) / name.str()).string();
+}
+
+// how the header, vertices and faces of a cache would look
+// (everything but the source and the statistics)
+inline cache_header cache_layout(const size_t vertices, const size_t faces)
+{
+	const auto align = [] (const uint64_t n) { return (n + 63) / 64 * 64; };
+
+	cache_header hdr;
+	std::memset(&hdr, 0, sizeof(hdr));
+	std::memcpy(hdr.magic, cache_magic, sizeof(hdr.magic));
+	hdr.version = cache_version;
+	hdr.header_size = sizeof(cache_header);
+	hdr.vertex_size = sizeof(vertex_t);
+	hdr.face_size = sizeof(face_t);
+
+	static_assert(sizeof(vertex_t) <= sizeof(hdr.vertex_probe), "vertex_t too large for the cache header");
+	static_assert(sizeof(face_t) <= sizeof(hdr.face_probe), "face_t too large for the cache header");
+	const vertex_t v(std::make_tuple(coord_t(1), coord_t(2), coord_t(3)));
+	const face_t fc(std::make_tuple(index_t(1), index_t(2), index_t(3)));
+	std::memcpy(hdr.vertex_probe, &v, sizeof(v));
+	std::memcpy(hdr.face_probe, &fc, sizeof(fc));
+
+	hdr.vertices = vertices;
+	hdr.faces = faces;
+	hdr.vertex_offset = align(sizeof(cache_header));
+	hdr.face_offset = align(hdr.vertex_offset + vertices * sizeof(vertex_t));
+	hdr.file_size = hdr.face_offset + faces * sizeof(face_t);
+	return hdr;
+}
+
+// writes the cache of m (with its statistics, and the outcome of parsing it)
+// to path: first to a temporary file, which is then renamed, so readers never
+// see half a cache. returns false if it couldn't be written.
+inline bool write_cache(
+	const std::string& path,
+	const model_t& m,
+	const mesh_stats& stats,
+	const bool syntax,
+	const bool semantics,
+	const cache_source& src)
+{
+	cache_header hdr = cache_layout(m.vertex_set().size(), m.mesh().size());
+	hdr.source = src;
+	const vertex_t* box[2] = { &stats.range().first, &stats.range().second };
+	for(int i = 0; i < 2; i++)
+	{
+		hdr.box[3 * i] = box[i] -> x();
+		hdr.box[3 * i + 1] = box[i] -> y();
+		hdr.box[3 * i + 2] = box[i] -> z();
+	}
+	hdr.surface = stats.surface();
+	hdr.volume = stats.volume();
+	hdr.syntax = syntax;
+	hdr.semantics = semantics;
+
+	boost::system::error_code ec;
+	const boost::filesystem::path target(path);
+	if(target.has_parent_path())
+	{
+		boost::filesystem::create_directories(target.parent_path(), ec);
+	}
+	const boost::filesystem::path tmp = boost::filesystem::unique_path(path + ".%%%%-%%%%-%%%%", ec);
+	if(ec)
+	{
+		return false;
+	}
+
+	{
+		std::ofstream out(tmp.string(), std::ios::binary | std::ios::trunc);
+		const char zeros[64] = { };
+		out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+		out.write(zeros, hdr.vertex_offset - sizeof(hdr));
+		out.write(reinterpret_cast<const char*>(m.vertex_set().data()), m.vertex_set().size() * sizeof(vertex_t));
+		out.write(zeros, hdr.face_offset - (hdr.vertex_offset + m.vertex_set().size() * sizeof(vertex_t)));
+		out.write(reinterpret_cast<const char*>(m.mesh().data()), m.mesh().size() * sizeof(face_t));
+		if(!out.good())
+		{
+			out.close();
+			boost::filesystem::remove(tmp, ec);
+			return false;
+		}
+	}
+	boost::filesystem::rename(tmp, target, ec);
+	if(ec)
+	{
+		boost::filesystem::remove(tmp, ec);
+		return false;
+	}
+	return true;
+}
+
+// a mapped cache file. the model (view()) points into the mapping:
+// it is only valid as long as this object lives.
+class cached_model final
+{
+private:
+	mapped_file file;
+	const cache_header* hdr;
+	model_view_t data;
+
+public:
+	cached_model(const std::string& path) : file(path), hdr(nullptr)
+	{
+		if(!file.is_open() || file.size() < sizeof(cache_header))
+		{
+			return;
+		}
+		const cache_header* h = reinterpret_cast<const cache_header*>(file.begin());
+		// the counts have to fit in the file before the layout is worked out
+		// from them (the sizes of the arrays could wrap around otherwise)
+		const uint64_t vertex_offset = cache_layout(0, 0).vertex_offset;
+		if(file.size() < vertex_offset
+			|| h -> vertices > (file.size() - vertex_offset) / sizeof(vertex_t))
+		{
+			return;
+		}
+		const uint64_t face_offset = cache_layout(h -> vertices, 0).face_offset;
+		if(file.size() < face_offset
+			|| h -> faces > (file.size() - face_offset) / sizeof(face_t))
+		{
+			return;
+		}
+		const cache_header expect = cache_layout(h -> vertices, h -> faces);
+		if(std::memcmp(h -> magic, expect.magic, sizeof(expect.magic)) != 0
+			|| h -> version != expect.version
+			|| h -> header_size != expect.header_size
+			|| h -> vertex_size != expect.vertex_size
+			|| h -> face_size != expect.face_size
+			|| std::memcmp(h -> vertex_probe, expect.vertex_probe, sizeof(expect.vertex_probe)) != 0
+			|| std::memcmp(h -> face_probe, expect.face_probe, sizeof(expect.face_probe)) != 0
+			|| h -> vertex_offset != expect.vertex_offset
+			|| h -> face_offset != expect.face_offset
+			|| h -> file_size != expect.file_size
+			|| file.size() != expect.file_size)
+		{
+			return;
+		}
+		hdr = h;
+		data.vertex_set() = array_view<vertex_t>(
+			reinterpret_cast<const vertex_t*>(file.begin() + hdr -> vertex_offset), hdr -> vertices);
+		data.mesh() = array_view<face_t>(
+			reinterpret_cast<const face_t*>(file.begin() + hdr -> face_offset), hdr -> faces);
+	}
+
+	cached_model(const cached_model&) = delete;
+	const cached_model& operator=(const cached_model&) = delete;
+
+	// a cache was found and can be used by this binary
+	const bool is_open() const { return hdr != nullptr; }
+
+	const cache_header& header() const { return *hdr; }
+	const model_view_t& view() const { return data; }
+	const bool syntax() const { return hdr -> syntax != 0; }
+	const bool semantics() const { return hdr -> semantics != 0; }
+
+	// statistics of the model, as they were when the cache was written
+	const mesh_stats stats() const
+	{
+		mesh_stats st;
+		st.box = range_t(
+			vertex_t(std::make_tuple(hdr -> box[0], hdr -> box[1], hdr -> box[2])),
+			vertex_t(std::make_tuple(hdr -> box[3], hdr -> box[4], hdr -> box[5])));
+		st.surf.add(hdr -> surface);
+		st.vol.add(hdr -> volume);
+		return st;
+	}
+
+	// was this cache made from (the current contents of) source.
+	// a source with the size and mtime it had then is assumed unchanged,
+	// one with another mtime (but the same size) is hashed.
+	const bool fresh(const std::string& source) const
+	{
+		boost::system::error_code ec;
+		const uint64_t size = boost::filesystem::file_size(source, ec);
+		if(ec || !is_open() || size != hdr -> source.size)
+		{
+			return false;
+		}
+		if(source_mtime(source) == hdr -> source.mtime)
+		{
+			return true;
+		}
+		mapped_file in(source);
+		return in.is_open() && hash_bytes(in.begin(), in.end()) == hdr -> source.hash;
+	}
+};
+
+#endif // CACHE_HEADER_FILE
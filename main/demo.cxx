@@ -8,12 +8,21 @@
 #include <iostream>
 #include <numeric>
 #include <map>
+#include <optional>
+#include <sstream>
 
 #include "types.hxx"
 #include "bbox.hxx"
+#include "broadphase.hxx"
+#include "parallel.hxx"
+#include "cache.hxx"
+#include "pipeline.hxx"
+#include "stream.hxx"
+#include "weld.hxx"
+#include "server.hxx"
+#include "instrument.hxx"
 #include "../parser/parser.hxx"
-#include "../algo/surface.hxx"
-#include "../algo/volume.hxx"
+#include "../algo/stats.hxx"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -24,48 +33,205 @@ void to_cout(const std::vector<std::string> &v)
     std::cout, "\n"});
 }
 
-std::map<std::string, model_t> parse_files(const std::vector<std::string>& files)
+// how the files are loaded
+struct load_options
 {
-	std::map<std::string, model_t> models;
+	unsigned threads = 1;
+	bool use_cache = false;
+	std::string cache_dir;   // (empty: next to the input files)
+	bool stream = false;     // see stream_stats
+	size_t stream_memory = size_t(256) << 20;
+	std::optional<scalar_t> weld; // weld within this distance (see weld)
+	size_t max_warnings = 10;     // of every kind, per file (see instrument::limited_log)
+};
 
-	std::for_each(
-		files.begin(),
-		files.end(),
-		[ &models ] (const std::string& patt)
+// statistics of m once it is welded
+mesh_stats welded_stats(
+	const std::string& patt,
+	const model_t& m,
+	const load_options& opt,
+	std::ostream& log)
+{
+	const auto res = weld(m, *opt.weld, true, opt.threads);
+	log << "Welded '" << patt << "': " << std::get<1>(res) << "\n";
+	return calculate_mesh_stats(std::get<0>(res), opt.threads);
+}
+
+// statistics of one file: streamed (opt.stream), from its cache when that is
+// enabled (opt.use_cache) and up to date, otherwise parsed (and cached).
+// the model is welded first if opt.weld is set (not when streaming, the
+// cache holds the model as it was parsed). messages go to log.
+std::optional<mesh_stats> load_file(
+	const std::string& patt,
+	const load_options& opt,
+	std::ostream& log)
+{
+	if(fs::is_directory(patt))
+	{			
+		log << "Is a directory: '" << patt << "'\n";
+		return std::nullopt;
+	}
+	if(!fs::is_regular_file(patt))
+	{
+		return std::nullopt;
+	}
+
+	if(opt.stream)
+	{
+		const auto res = stream_stats(patt, opt.stream_memory, size_t(1) << 20, log);
+		if(!(std::get<1>(res) && std::get<2>(res) && std::get<3>(res) > 0))
+		{
+			log << "Unable to extract model from '" << patt << "'\n";
+		}
+		return std::get<0>(res);
+	}
+
+	const bool use_cache = opt.use_cache;
+	const unsigned threads = opt.threads;
+	const std::string cache_file = use_cache ? cache_path(patt, opt.cache_dir) : "";
+	if(use_cache)
+	{
+		cached_model cached(cache_file);
+		if(cached.is_open() && cached.fresh(patt))
 		{
-			if(fs::is_directory(patt))
-			{			
-				std::cerr << "Is a directory: '" << patt << "'\n";
-				return;
+			if(!(cached.syntax() && cached.semantics() && cached.view().mesh().size() > 0))
+			{
+				log << "Unable to extract model from '" << patt << "'\n";
 			}
-			if(fs::is_regular_file(patt))
+			if(opt.weld)
 			{
+				model_t m;
+				const model_view_t& view = cached.view();
+				m.vertex_set().assign(view.vertex_set().begin(), view.vertex_set().end());
+				m.mesh().assign(view.mesh().begin(), view.mesh().end());
+				return welded_stats(patt, m, opt, log);
+			}
+			return cached.stats();
+		}
+	}
 
-				std::ifstream in(patt);
-				if(!in.is_open())
-				{
-					std::cerr << "Can't open '" << patt << "'\n";
-					return;
-				}
+	std::optional<mapped_file> mapped;
+	{
+		INSTRUMENT_TIMER(io);
+		mapped.emplace(patt);
+	}
+	const mapped_file& in = *mapped;
+	if(!in.is_open())
+	{
+		log << "Can't open '" << patt << "'\n";
+		return std::nullopt;
+	}
 
-				auto res = parse(in);
-				bool syntax = std::get<1>(res);
-				bool semantics = std::get<2>(res);
+	auto res = parse(in, parse_mode::single_pass, threads, log);
+	bool syntax = std::get<1>(res);
+	bool semantics = std::get<2>(res);
 
-				if(!(syntax && semantics && std::get<0>(res).mesh().size() > 0))
-				{
-					std::cerr << "Unable to extract model from '" << patt << "'\n";
-				}
+	if(!(syntax && semantics && std::get<0>(res).mesh().size() > 0))
+	{
+		log << "Unable to extract model from '" << patt << "'\n";
+	}
+
+	if(opt.weld && !use_cache)
+	{
+		return welded_stats(patt, std::get<0>(res), opt, log);
+	}
+
+	const mesh_stats stats = calculate_mesh_stats(std::get<0>(res), threads);
+	if(use_cache && !write_cache(
+		cache_file,
+		std::get<0>(res),
+		stats,
+		syntax,
+		semantics,
+		describe_source(patt, in.begin(), in.end())))
+	{
+		log << "Can't write cache '" << cache_file << "'\n";
+	}
+	return opt.weld ? welded_stats(patt, std::get<0>(res), opt, log) : stats;
+}
+
+// statistics of every file (see load_file). Several files are loaded at the
+// same time (each on its own thread, the remaining threads help within a
+// file), their messages are printed in the order of the files.
+std::map<std::string, mesh_stats> parse_files(
+	const std::vector<std::string>& files,
+	const load_options& opt)
+{
+	INSTRUMENT_TIMER(load);
+	std::map<std::string, mesh_stats> models;
+
+	const unsigned workers = std::max(1u, std::min<unsigned>(opt.threads, files.size()));
+	load_options per_file = opt;
+	per_file.threads = std::max(1u, opt.threads / workers);
 
+	struct loaded
+	{
+		std::optional<mesh_stats> stats;
+		std::string log;
+	};
+
+	ordered_pipeline(
+		files.size(),
+		workers,
+		2 * workers,
+		[ &files, &per_file ] (const size_t i)
+		{
+			std::ostringstream log;
+			loaded res;
+			{
+				instrument::limited_log limited(log, per_file.max_warnings);
+				res.stats = load_file(files[i], per_file, limited);
+			}
+			res.log = log.str();
+			return res;
+		},
+		[ &models, &files ] (const size_t i, loaded&& res)
+		{
+			std::cerr << res.log;
+			if(res.stats)
+			{
 				models.emplace(
-					fs::path(patt).filename().string(),
-					std::move(std::get<0>(res)));
+					fs::path(files[i]).filename().string(),
+					*res.stats);
 			}
 		}
 	);
 	return std::move(models);
 }
 
+void print_comparison(
+	const std::string& name_a,
+	const aabb& a,
+	const std::string& name_b,
+	const aabb& b)
+{
+	std::cout << "\n";
+	std::cout << "comparing '" << name_a << "' (a) with '" << name_b << "' (b):\n";
+	aabb uni = (a | b);
+	std::cout << " a union b: " << uni << "\n"; 
+	std::cout << " a union b surface: " << uni.surface() << "\n"; 
+	std::cout << " a union b volume: " << uni.volume() << "\n"; 
+	aabb inr = (a & b);
+	std::cout << " a intersection b: ";
+	if(!inr)
+	{
+		std::cout << "empty\n";
+	}
+	else
+	{
+		std::cout << inr << "\n";
+		std::cout << " a intersection b surface: " << inr.surface() << "\n"; 
+		std::cout << " a intersection b volume: " << inr.volume() << "\n"; 
+	}
+	std::cout << " a equals b: " << std::boolalpha << (a == b) << "\n";
+	std::cout << " a fully contains b: " << std::boolalpha << (a > b) << "\n";
+	std::cout << " a fully contained by b: " << std::boolalpha << (a < b) << "\n";
+	std::cout << " a contains b: " << std::boolalpha << (a >= b) << "\n";
+	std::cout << " a contained by b: " << std::boolalpha << (a <= b) << "\n";
+	std::cout << " a intersects b: " << std::boolalpha << (a && b) << "\n";
+	std::cout << " a excludes b: " << std::boolalpha << (a || b) << "\n";
+}
+
 int main(int argc, const char *argv[])
 {
 	try
@@ -78,7 +244,38 @@ int main(int argc, const char *argv[])
 		 		po::value<std::vector<std::string>>()
 				->multitoken()
 				->zero_tokens()
-				->composing(), "Input file(s)");
+				->composing(), "Input file(s)")
+			("threads,j",
+				po::value<unsigned>()->default_value(default_threads()),
+				"Number of threads used to parse and analyse a file")
+			("cache", "Cache parsed models in binary form, next to the input files")
+			("cache-dir",
+				po::value<std::string>(),
+				"Cache parsed models in binary form, in this directory")
+			("stream", "Compute the statistics while reading the files, without building the models")
+			("stream-memory",
+				po::value<size_t>()->default_value(256),
+				"Memory (in MB) for the vertices of a streamed file, the rest goes to a temporary file")
+			("weld",
+				po::value<scalar_t>(),
+				"Weld vertices closer than this distance, drop degenerate and duplicate faces (not with --stream)")
+			("max-warnings",
+				po::value<size_t>()->default_value(10),
+				"Warnings of the same kind shown per file, the rest is only counted")
+			("stats", "Report times and counters of the loading (on stderr)")
+			("stats-format",
+				po::value<std::string>()->default_value("text"),
+				"Format of the --stats report: text or json")
+			("overlaps-only", "Only compare models whose boxes intersect")
+			("serve",
+				po::value<std::string>(),
+				"Answer queries on this Unix socket, keeping the models in memory (see main/server.hxx)")
+			("serve-memory",
+				po::value<size_t>()->default_value(1024),
+				"Memory (in MB) for the models kept by --serve")
+			("query",
+				po::value<std::string>(),
+				"Send the input words as a query to the server on this Unix socket, print its answer");
 
 		po::positional_options_description pos_desc;
 		pos_desc.add("input", -1);
@@ -93,14 +290,76 @@ int main(int argc, const char *argv[])
 		po::store(parsed_options, vm);
 		po::notify(vm);
 
-		std::map<std::string, model_t> models;
+		const unsigned threads = std::max(1u, vm["threads"].as<unsigned>());
+		std::vector<std::string> inputs;
+		if(vm.count("input"))
+		{
+			inputs = vm["input"].as<std::vector<std::string>>();
+		}
+		const std::string stats_format = vm["stats-format"].as<std::string>();
+		if(stats_format != "text" && stats_format != "json")
+		{
+			throw po::error("the argument ('" + stats_format + "') for option '--stats-format' is invalid (text or json)");
+		}
+
+		if(vm.count("serve") && !vm.count("help"))
+		{
+			server_options so;
+			so.memory = vm["serve-memory"].as<size_t>() << 20;
+			so.workers = threads;
+			model_server server(vm["serve"].as<std::string>(), so);
+			if(!server.is_open())
+			{
+				std::cerr << "Can't listen on '" << vm["serve"].as<std::string>() << "'\n";
+				return 1;
+			}
+			server.run();
+			return 0;
+		}
+		if(vm.count("query") && !vm.count("help"))
+		{
+			std::string query;
+			for(const std::string& w: inputs)
+			{
+				query += (query.empty() ? "" : " ") + w;
+			}
+			const std::optional<std::string> answer = send_query(vm["query"].as<std::string>(), query);
+			if(!answer)
+			{
+				std::cerr << "No answer from '" << vm["query"].as<std::string>() << "'\n";
+				return 1;
+			}
+			std::cout << *answer << "\n";
+			return answer -> compare(0, 2, "ok") == 0 ? 0 : 1;
+		}
+
+		std::map<std::string, mesh_stats> models;
 		if(vm.count("help"))
 		{
 			std::cout << desc << '\n';
 		}
-		else if(vm.count("input"))
+		else if(!inputs.empty())
 		{
-			models = parse_files(vm["input"].as<std::vector<std::string>>());
+			load_options opt;
+			opt.threads = threads;
+			opt.use_cache = vm.count("cache") + vm.count("cache-dir") > 0;
+			opt.cache_dir = vm.count("cache-dir") ? vm["cache-dir"].as<std::string>() : "";
+			opt.stream = vm.count("stream") > 0;
+			opt.stream_memory = vm["stream-memory"].as<size_t>() << 20;
+			if(vm.count("weld"))
+			{
+				opt.weld = vm["weld"].as<scalar_t>();
+			}
+			if(opt.stream && opt.weld)
+			{
+				std::cerr << "--weld is ignored with --stream\n";
+			}
+			opt.max_warnings = vm["max-warnings"].as<size_t>();
+			models = parse_files(inputs, opt);
+			if(vm.count("stats"))
+			{
+				instrument::report(std::cerr, stats_format == "json");
+			}
 		}
 		else
 		{
@@ -117,15 +376,16 @@ int main(int argc, const char *argv[])
 		std::for_each(
 			models.begin(),
 			models.end(),
-			[ &boxes ] (const std::pair<std::string, model_t>& mod)
+			[ &boxes ] (const std::pair<std::string, mesh_stats>& mod)
 			{
-				aabb box(mod.second);
+				const mesh_stats& stats = mod.second;
+				aabb box(stats.range());
 				std::cout << mod.first << ":\n";
 				std::cout << " aabb: " << box << "\n";
 				std::cout << " aabb surface: " << box.surface() << "\n";
 				std::cout << " aabb volume: " << box.volume() << "\n";
-				std::cout << " object's surface: "  << calculate_surface(mod.second) << ":\n";
-				std::cout << " object's volume: "  << calculate_volume(mod.second) << ":\n";
+				std::cout << " object's surface: "  << stats.surface() << ":\n";
+				std::cout << " object's volume: "  << stats.volume() << ":\n";
 				boxes.emplace(
 					mod.first,
 					std::move(box));
@@ -138,42 +398,33 @@ int main(int argc, const char *argv[])
 			return 0;
 		}
 
-		for(auto it = boxes.begin(); it != boxes.end(); it++)
+		if(vm.count("overlaps-only"))
 		{
-			auto nxt = std::next(it);
-			std::for_each(
-				nxt, boxes.end(),
-				[ &it ] (const std::pair<std::string, aabb>& it2)
-				{
-					const aabb& a = it -> second;
-					const aabb& b = it2.second;
-					std::cout << "\n";
-					std::cout << "comparing '" << (it -> first) << "' (a) with '" << it2.first << "' (b):\n";
-					aabb uni = (a | b);
-					std::cout << " a union b: " << uni << "\n"; 
-					std::cout << " a union b surface: " << uni.surface() << "\n"; 
-					std::cout << " a union b volume: " << uni.volume() << "\n"; 
-					aabb inr = (a & b);
-					std::cout << " a intersection b: ";
-					if(!inr)
-					{
-						std::cout << "empty\n";
-					}
-					else
+			// only the pairs whose boxes intersect (see overlapping_pairs)
+			std::vector<std::string> names;
+			std::vector<aabb> all;
+			for(const auto& b: boxes)
+			{
+				names.push_back(b.first);
+				all.push_back(b.second);
+			}
+			for(const box_pair_t& p: overlapping_pairs(all))
+			{
+				print_comparison(names[p.first], all[p.first], names[p.second], all[p.second]);
+			}
+		}
+		else
+		{
+			for(auto it = boxes.begin(); it != boxes.end(); it++)
+			{
+				std::for_each(
+					std::next(it), boxes.end(),
+					[ &it ] (const std::pair<std::string, aabb>& it2)
 					{
-						std::cout << inr << "\n";
-						std::cout << " a intersection b surface: " << inr.surface() << "\n"; 
-						std::cout << " a intersection b volume: " << inr.volume() << "\n"; 
+						print_comparison(it -> first, it -> second, it2.first, it2.second);
 					}
-					std::cout << " a equals b: " << std::boolalpha << (a == b) << "\n";
-					std::cout << " a fully contains b: " << std::boolalpha << (a > b) << "\n";
-					std::cout << " a fully contained by b: " << std::boolalpha << (a < b) << "\n";
-					std::cout << " a contains b: " << std::boolalpha << (a >= b) << "\n";
-					std::cout << " a contained by b: " << std::boolalpha << (a <= b) << "\n";
-					std::cout << " a intersects b: " << std::boolalpha << (a && b) << "\n";
-					std::cout << " a excludes b: " << std::boolalpha << (a || b) << "\n";
-				}
-			);
+				);
+			}
 		}
 
 		aabb full_uni = boxes.begin() -> second;
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "editable.hxx"
+#include "../algo/bounding.hxx"
+#include "../algo/surface.hxx"
+#include "../algo/volume.hxx"
+
+editable_model::editable_model(model_t&& m) : mod(std::move(m)), leaves(0)
+{
+	faces_of.resize(mod.vertex_set().size());
+	for(index_t f = 0; f < mod.mesh().size(); f++)
+	{
+		link(f);
+		account(f, 1);
+	}
+	rebuild_tree();
+}
+
+editable_model::editable_model(const model_t& m) : editable_model(model_t(m)) {}
+
+const model_t& editable_model::source() const
+{ return mod; }
+
+void editable_model::rebuild_tree()
+{
+	const index_t chunks = (mod.vertex_set().size() + chunk - 1) / chunk;
+	for(leaves = 1; leaves < chunks; leaves *= 2);
+	tree.assign(2 * leaves, range_t(
+		vertex_t(std::numeric_limits<coord_t>::infinity()),
+		vertex_t(-std::numeric_limits<coord_t>::infinity())));
+	for(index_t c = 0; c < chunks; c++)
+	{
+		const index_t b = c * chunk;
+		const index_t e = std::min(b + chunk, mod.vertex_set().size());
+		tree[leaves + c] = calculate_aabb(mod.vertex_set().begin() + b, mod.vertex_set().begin() + e);
+	}
+	for(index_t i = leaves - 1; i > 0; i--)
+	{
+		tree[i] = range_t(tree[2 * i].first.min(tree[2 * i + 1].first), tree[2 * i].second.max(tree[2 * i + 1].second));
+	}
+}
+
+void editable_model::update_chunk(const index_t c)
+{
+	const index_t b = c * chunk;
+	const index_t e = std::min(b + chunk, mod.vertex_set().size());
+	index_t i = leaves + c;
+	tree[i] = calculate_aabb(mod.vertex_set().begin() + b, mod.vertex_set().begin() + e);
+	for(i /= 2; i > 0; i /= 2)
+	{
+		tree[i] = range_t(tree[2 * i].first.min(tree[2 * i + 1].first), tree[2 * i].second.max(tree[2 * i + 1].second));
+	}
+}
+
+void editable_model::account(const index_t f, const scalar_t sign)
+{
+	const face_t& fc = mod.mesh()[f];
+	const vertex_t& a = mod.vertex_set()[fc.a()];
+	const vertex_t& b = mod.vertex_set()[fc.b()];
+	const vertex_t& c = mod.vertex_set()[fc.c()];
+	surf.add(sign * triangle_surface(a, b, c));
+	vol.add(sign * signed_volume(a, b, c));
+}
+
+void editable_model::link(const index_t f)
+{
+	const face_t& fc = mod.mesh()[f];
+	faces_of[fc.a()].push_back(f);
+	if(fc.b() != fc.a())
+	{
+		faces_of[fc.b()].push_back(f);
+	}
+	if(fc.c() != fc.a() && fc.c() != fc.b())
+	{
+		faces_of[fc.c()].push_back(f);
+	}
+}
+
+void editable_model::unlink(const index_t f)
+{
+	const face_t& fc = mod.mesh()[f];
+	for(const index_t v: { fc.a(), fc.b(), fc.c() })
+	{
+		std::vector<index_t>& fs = faces_of[v];
+		const std::vector<index_t>::iterator it = std::find(fs.begin(), fs.end(), f);
+		if(it != fs.end())
+		{
+			*it = fs.back();
+			fs.pop_back();
+		}
+	}
+}
+
+index_t editable_model::add_vertex(const vertex_t& v)
+{
+	mod.vertex_set().push_back(v);
+	faces_of.emplace_back();
+	const index_t c = (mod.vertex_set().size() - 1) / chunk;
+	if(c >= leaves)
+	{
+		rebuild_tree();
+	}
+	else
+	{
+		update_chunk(c);
+	}
+	return mod.vertex_set().size() - 1;
+}
+
+const bool editable_model::move_vertex(const index_t i, const vertex_t& v)
+{
+	if(i >= mod.vertex_set().size())
+	{
+		return false;
+	}
+	for(const index_t f: faces_of[i])
+	{
+		account(f, -1);
+	}
+	mod.vertex_set()[i] = v;
+	for(const index_t f: faces_of[i])
+	{
+		account(f, 1);
+	}
+	update_chunk(i / chunk);
+	return true;
+}
+
+const bool editable_model::add_face(const face_t& f)
+{
+	const index_t n = mod.vertex_set().size();
+	if(f.a() >= n || f.b() >= n || f.c() >= n)
+	{
+		return false;
+	}
+	mod.mesh().push_back(f);
+	link(mod.mesh().size() - 1);
+	account(mod.mesh().size() - 1, 1);
+	return true;
+}
+
+const bool editable_model::remove_face(const index_t f)
+{
+	if(f >= mod.mesh().size())
+	{
+		return false;
+	}
+	const index_t last = mod.mesh().size() - 1;
+	account(f, -1);
+	unlink(f);
+	if(f != last)
+	{
+		unlink(last);
+		mod.mesh()[f] = mod.mesh()[last];
+		link(f);
+	}
+	mod.mesh().pop_back();
+	return true;
+}
+
+const aabb editable_model::box() const
+{ return aabb(tree[1]); }
+
+const scalar_t editable_model::surface() const
+{ return surf.value(); }
+
+const scalar_t editable_model::volume() const
+{ return vol.value(); }
+
+const mesh_stats editable_model::stats() const
+{
+	mesh_stats st;
+	st.box = tree[1];
+	st.surf = surf;
+	st.vol = vol;
+	return st;
+}
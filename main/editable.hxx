@@ -0,0 +1,67 @@
+#ifndef EDITABLE_HEADER_FILE
+#define EDITABLE_HEADER_FILE
+
+#include <vector>
+
+#include "types.hxx"
+#include "bbox.hxx"
+#include "../algo/stats.hxx"
+
+// a model that is edited in place, with its aabb, surface and volume
+// kept up to date
+//
+// Surface and volume are (compensated) sums over the faces: an edit takes out
+// what the faces it touches added and adds what they add now. The aabb is the
+// root of a min/max tree over chunks of vertices, so it also shrinks when the
+// extreme vertex moves inwards. Every face is known by its vertices, so an
+// edit costs time in the number of faces it touches (and log(vertices)), not
+// in the size of the model.
+//
+// As aabb(model) does, the box covers all vertices (used or not).
+class editable_model
+{
+public:
+	// vertices per leaf of the min/max tree
+	static const index_t chunk = 64;
+
+private:
+	model_t mod;
+	std::vector<std::vector<index_t>> faces_of; // faces of every vertex (once per face)
+	compensated_sum surf;
+	compensated_sum vol;
+	std::vector<range_t> tree; // tree[1] is the root, the chunks are at [leaves, 2 * leaves)
+	index_t leaves;
+
+	void rebuild_tree();
+	void update_chunk(const index_t c);
+	// takes out (sign -1) or adds (sign 1) what face f adds to surface and volume
+	void account(const index_t f, const scalar_t sign);
+	void link(const index_t f);
+	void unlink(const index_t f);
+
+public:
+	editable_model(model_t&& m);
+	editable_model(const model_t& m);
+
+	// the model as it is now
+	const model_t& source() const;
+
+	// adds a vertex, returns its index
+	index_t add_vertex(const vertex_t& v);
+	// moves vertex i to v; returns false (and leaves the model as it is)
+	// if there is no vertex i
+	const bool move_vertex(const index_t i, const vertex_t& v);
+	// adds a face (as the last one); returns false (and leaves the model
+	// as it is) if it points to a vertex that does not exist
+	const bool add_face(const face_t& f);
+	// removes face f: the last face takes its place; returns false (and
+	// leaves the model as it is) if there is no face f
+	const bool remove_face(const index_t f);
+
+	const aabb box() const;
+	const scalar_t surface() const;
+	const scalar_t volume() const;
+	const mesh_stats stats() const;
+};
+
+#endif // EDITABLE_HEADER_FILE
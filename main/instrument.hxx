@@ -0,0 +1,293 @@
+#ifndef INSTRUMENT_HEADER_FILE
+#define INSTRUMENT_HEADER_FILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+///////////////////////////////////////////
+//           instrumentation             //
+///////////////////////////////////////////
+
+// Process-wide timers and counters of the hot paths (reading, parsing,
+// building the model, the kernels in algo/), see demo --stats.
+// They are updated once per call of a stage, not per vertex or face: a timer
+// is two clock reads and two relaxed atomic additions, a counter one addition.
+// Timers add up over threads (several files are loaded at the same time).
+//
+// Building with -DNO_INSTRUMENTATION removes them: INSTRUMENT_TIMER and
+// INSTRUMENT_COUNT expand to nothing (their arguments are not evaluated).
+
+namespace instrument
+{
+
+enum class counter
+{
+	bytes_read,
+	vertices_read,
+	vertices_unused,
+	faces_read,
+	faces_accepted,
+	faces_dropped,
+	hash_probes,
+	warnings,
+	warnings_suppressed,
+	count_
+};
+
+enum class timer
+{
+	load,   // parse_files, start to end
+	io,     // opening / mapping files and caches
+	parse,  // scanning the OBJ text
+	remap,  // building the model from what was scanned
+	stats,  // calculate_mesh_stats
+	aabb,   // calculate_aabb (of a model)
+	surface,
+	volume,
+	weld,
+	count_
+};
+
+inline const char* name(const counter c)
+{
+	static const char* const names[] = {
+		"bytes_read", "vertices_read", "vertices_unused", "faces_read", "faces_accepted",
+		"faces_dropped", "hash_probes", "warnings", "warnings_suppressed" };
+	return names[size_t(c)];
+}
+
+inline const char* name(const timer t)
+{
+	static const char* const names[] = {
+		"load", "io", "parse", "remap", "stats", "aabb", "surface", "volume", "weld" };
+	return names[size_t(t)];
+}
+
+struct registry
+{
+	std::atomic<uint64_t> counts[size_t(counter::count_)];
+	std::atomic<uint64_t> nanos[size_t(timer::count_)];
+	std::atomic<uint64_t> calls[size_t(timer::count_)];
+};
+
+// (zero-initialised, as a static)
+inline registry& global()
+{
+	static registry r;
+	return r;
+}
+
+#ifndef NO_INSTRUMENTATION
+const bool enabled = true;
+#else
+const bool enabled = false;
+#endif
+
+inline void add(const counter c, const uint64_t n)
+{
+	global().counts[size_t(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+// adds the time from its construction to its destruction to timer t
+class scoped_timer final
+{
+private:
+	const timer t;
+	const std::chrono::steady_clock::time_point start;
+
+public:
+	scoped_timer(const timer t) : t(t), start(std::chrono::steady_clock::now()) {}
+
+	~scoped_timer()
+	{
+		const auto d = std::chrono::steady_clock::now() - start;
+		global().nanos[size_t(t)].fetch_add(
+			uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()),
+			std::memory_order_relaxed);
+		global().calls[size_t(t)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	scoped_timer(const scoped_timer&) = delete;
+	const scoped_timer& operator=(const scoped_timer&) = delete;
+};
+
+#ifndef NO_INSTRUMENTATION
+#define INSTRUMENT_JOIN_(a, b) a##b
+#define INSTRUMENT_JOIN(a, b) INSTRUMENT_JOIN_(a, b)
+// times the rest of the enclosing scope
+#define INSTRUMENT_TIMER(t) \
+	const instrument::scoped_timer INSTRUMENT_JOIN(instrument_timer_, __LINE__)(instrument::timer::t)
+#define INSTRUMENT_COUNT(c, n) instrument::add(instrument::counter::c, (n))
+#else
+#define INSTRUMENT_TIMER(t)
+#define INSTRUMENT_COUNT(c, n) ((void) sizeof(n))
+#endif
+
+inline void reset()
+{
+	for(std::atomic<uint64_t>& c: global().counts)
+	{
+		c.store(0, std::memory_order_relaxed);
+	}
+	for(size_t t = 0; t < size_t(timer::count_); t++)
+	{
+		global().nanos[t].store(0, std::memory_order_relaxed);
+		global().calls[t].store(0, std::memory_order_relaxed);
+	}
+}
+
+// all timers and counters, as text (a line each) or as json (one line)
+inline void report(std::ostream& o, const bool json)
+{
+	const registry& r = global();
+	if(json)
+	{
+		o << "{\"enabled\": " << std::boolalpha << enabled << ", \"timers\": {";
+		for(size_t t = 0; t < size_t(timer::count_); t++)
+		{
+			o << (t ? ", " : "") << "\"" << name(timer(t)) << "\": { \"ms\": "
+				<< r.nanos[t].load() / 1e6 << ", \"calls\": " << r.calls[t].load() << " }";
+		}
+		o << "}, \"counters\": {";
+		for(size_t c = 0; c < size_t(counter::count_); c++)
+		{
+			o << (c ? ", " : "") << "\"" << name(counter(c)) << "\": " << r.counts[c].load();
+		}
+		o << "}}\n";
+		return;
+	}
+
+	if(!enabled)
+	{
+		o << "Statistics: not available (built with NO_INSTRUMENTATION)\n";
+		return;
+	}
+	o << "Statistics (times add up over threads):\n";
+	for(size_t t = 0; t < size_t(timer::count_); t++)
+	{
+		o << " " << std::left << std::setw(20) << name(timer(t)) << std::right
+			<< std::setw(12) << std::fixed << std::setprecision(3) << r.nanos[t].load() / 1e6 << " ms"
+			<< std::setw(10) << r.calls[t].load() << " calls\n";
+	}
+	o.unsetf(std::ios::floatfield);
+	for(size_t c = 0; c < size_t(counter::count_); c++)
+	{
+		o << " " << std::left << std::setw(20) << name(counter(c)) << std::right
+			<< std::setw(12) << r.counts[c].load() << "\n";
+	}
+}
+
+// passes all lines on to another stream, except for the warnings (lines that
+// start with "**Warning") beyond the first 'limit' of every kind (warnings
+// that only differ in their numbers are of the same kind). finish() reports
+// how many of every kind were left out.
+class limited_log final : public std::ostream
+{
+private:
+	class filter final : public std::streambuf
+	{
+	private:
+		std::ostream& out;
+		const size_t limit;
+		std::string line;
+		std::map<std::string, size_t> kinds; // (seen)
+
+		void emit()
+		{
+			if(line.compare(0, 9, "**Warning") == 0)
+			{
+				std::string kind;
+				for(size_t i = 0; i < line.size(); i++)
+				{
+					const bool digit = line[i] >= '0' && line[i] <= '9';
+					if(!digit)
+					{
+						kind += line[i];
+					}
+					else if(i == 0 || !(line[i - 1] >= '0' && line[i - 1] <= '9'))
+					{
+						kind += '#';
+					}
+				}
+				INSTRUMENT_COUNT(warnings, 1);
+				if(++kinds[kind] > limit)
+				{
+					INSTRUMENT_COUNT(warnings_suppressed, 1);
+					line.clear();
+					return;
+				}
+			}
+			out << line;
+			line.clear();
+		}
+
+	protected:
+		int overflow(const int c) override
+		{
+			if(c != traits_type::eof())
+			{
+				line += char(c);
+				if(c == '\n')
+				{
+					emit();
+				}
+			}
+			return traits_type::not_eof(c);
+		}
+
+		std::streamsize xsputn(const char* s, const std::streamsize n) override
+		{
+			for(std::streamsize i = 0; i < n; i++)
+			{
+				line += s[i];
+				if(s[i] == '\n')
+				{
+					emit();
+				}
+			}
+			return n;
+		}
+
+	public:
+		filter(std::ostream& out, const size_t limit) : out(out), limit(limit) {}
+
+		void finish()
+		{
+			if(!line.empty())
+			{
+				emit();
+			}
+			for(const std::pair<const std::string, size_t>& k: kinds)
+			{
+				if(k.second > limit)
+				{
+					out << "**Warning: " << (k.second - limit) << " more like '"
+						<< k.first.substr(0, k.first.size() - (k.first.back() == '\n')) << "'\n";
+				}
+			}
+			kinds.clear();
+		}
+	};
+
+	filter buf;
+
+public:
+	limited_log(std::ostream& out, const size_t limit) : std::ostream(nullptr), buf(out, limit)
+	{
+		rdbuf(&buf);
+	}
+
+	~limited_log() { buf.finish(); }
+
+	void finish() { buf.finish(); }
+};
+
+} // namespace instrument
+
+#endif // INSTRUMENT_HEADER_FILE
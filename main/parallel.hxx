@@ -0,0 +1,87 @@
+#ifndef PARALLEL_HEADER_FILE
+#define PARALLEL_HEADER_FILE
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// number of threads to use when nothing else is specified
+inline unsigned default_threads()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// runs fn(i) for every i in [0, n), spread over (at most) 'threads' threads.
+// the work is handed out one i at a time, so fn(i) should be a decent chunk
+// of work. the calling thread takes part as well; returns when all is done.
+template<typename Fn>
+void parallel_for(const size_t n, const unsigned threads, Fn fn)
+{
+	const size_t workers = std::min<size_t>(std::max(1u, threads), n);
+	if(workers <= 1)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			fn(i);
+		}
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	auto work = [ &next, n, &fn ] ()
+	{
+		for(size_t i = next++; i < n; i = next++)
+		{
+			fn(i);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve(workers - 1);
+	for(size_t t = 1; t < workers; t++)
+	{
+		pool.emplace_back(work);
+	}
+	work();
+	for(std::thread& t: pool)
+	{
+		t.join();
+	}
+}
+
+// sorts v (as std::sort does) on (at most) 'threads' threads: parts of v are
+// sorted in parallel, then merged two by two. with a strict total order (no
+// equal elements) the result doesn't depend on the number of threads.
+template<typename T, typename Less>
+void parallel_sort(std::vector<T>& v, const unsigned threads, Less less)
+{
+	const size_t parts = std::min<size_t>(std::max(1u, threads), v.size() >> 14);
+	if(parts <= 1)
+	{
+		std::sort(v.begin(), v.end(), less);
+		return;
+	}
+
+	std::vector<size_t> bounds(parts + 1);
+	for(size_t p = 0; p <= parts; p++)
+	{
+		bounds[p] = v.size() * p / parts;
+	}
+	parallel_for(parts, threads, [ &v, &bounds, &less ] (const size_t p)
+	{
+		std::sort(v.begin() + bounds[p], v.begin() + bounds[p + 1], less);
+	});
+	for(size_t width = 1; width < parts; width *= 2)
+	{
+		parallel_for((parts + 2 * width - 1) / (2 * width), threads, [ &v, &bounds, &less, parts, width ] (const size_t m)
+		{
+			const size_t b = 2 * width * m;
+			const size_t mid = std::min(b + width, parts);
+			const size_t e = std::min(b + 2 * width, parts);
+			std::inplace_merge(v.begin() + bounds[b], v.begin() + bounds[mid], v.begin() + bounds[e], less);
+		});
+	}
+}
+
+#endif // PARALLEL_HEADER_FILE
@@ -0,0 +1,130 @@
+#ifndef PIPELINE_HEADER_FILE
+#define PIPELINE_HEADER_FILE
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// runs work(i) for every i in [0, n) on (at most) 'threads' threads and hands
+// the results to done(i, result) on the calling thread, in order of i.
+// no work is started more than 'window' items ahead of the last result that
+// was handed to done: a slow consumer holds the workers back, and at most
+// 'window' results wait at any time. returns when all is done.
+// if work or done throws, no more work is started, and the (first)
+// exception is thrown again on the calling thread once the workers are done.
+template<typename Work, typename Done>
+void ordered_pipeline(const size_t n, const unsigned threads, const size_t window, Work work, Done done)
+{
+	typedef decltype(work(size_t(0))) result_t;
+
+	const size_t workers = std::min<size_t>(std::max(1u, threads), n);
+	const size_t slots = std::max<size_t>(1, window);
+	if(workers <= 1)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			done(i, work(i));
+		}
+		return;
+	}
+
+	std::mutex lock;
+	std::condition_variable can_start;
+	std::condition_variable has_result;
+	std::vector<std::optional<result_t>> results(slots);
+	size_t next = 0;    // next item to start
+	size_t emitted = 0; // items handed to done
+	std::exception_ptr failure;
+
+	// (with the lock held)
+	const auto fail = [ & ] (const std::exception_ptr e)
+	{
+		if(!failure)
+		{
+			failure = e;
+		}
+		can_start.notify_all();
+		has_result.notify_all();
+	};
+
+	auto run = [ & ] ()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		for(;;)
+		{
+			can_start.wait(guard, [ & ] () { return failure || next >= n || next < emitted + slots; });
+			if(failure || next >= n)
+			{
+				return;
+			}
+			const size_t i = next++;
+			guard.unlock();
+			std::optional<result_t> res;
+			std::exception_ptr e;
+			try
+			{
+				res.emplace(work(i));
+			}
+			catch(...)
+			{
+				e = std::current_exception();
+			}
+			guard.lock();
+			if(e)
+			{
+				fail(e);
+				return;
+			}
+			results[i % slots].emplace(std::move(*res));
+			has_result.notify_all();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve(workers);
+	for(size_t t = 0; t < workers; t++)
+	{
+		pool.emplace_back(run);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		has_result.wait(guard, [ & ] () { return failure || results[i % slots].has_value(); });
+		if(failure)
+		{
+			break;
+		}
+		result_t res = std::move(*results[i % slots]);
+		results[i % slots].reset();
+		emitted++;
+		can_start.notify_all();
+		guard.unlock();
+		try
+		{
+			done(i, std::move(res));
+		}
+		catch(...)
+		{
+			guard.lock();
+			fail(std::current_exception());
+			break;
+		}
+	}
+
+	for(std::thread& t: pool)
+	{
+		t.join();
+	}
+	if(failure)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+#endif // PIPELINE_HEADER_FILE
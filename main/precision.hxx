@@ -0,0 +1,182 @@
+#ifndef PRECISION_HEADER_FILE
+#define PRECISION_HEADER_FILE
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "types.hxx"
+
+///////////////////////////////////////////
+//        reduced precision models       //
+///////////////////////////////////////////
+
+// Besides double_precision (24 bytes per vertex, 24 per face) there are:
+//
+// single_precision: float coordinates, 32-bit indices (12 + 12 bytes).
+// 	every coordinate is the double one rounded to float: its relative
+// 	error is at most 2^-24 (so every vertex moves at most
+// 	d = 2^-24 * sqrt(3) * max |coordinate|).
+//
+// quantized_precision: 16-bit coordinates relative to the aabb of the vertex
+// set, 32-bit indices (6 + 12 bytes).
+// 	per axis a coordinate is off by at most half a step, where a step is the
+// 	extent of the aabb along that axis / 65535 (so every vertex moves at most
+// 	d = |steps| / 2). the aabb itself is kept (up to rounding).
+//
+// Surface and volume are still accumulated in double. When every vertex moves
+// at most d, the error on the surface of a triangle (a, b, c) is at most
+// 	d * (|b - a| + |c - a|) + 2 * d^2
+// and on its signed volume (with the origin) at most
+// 	(d * (|a||b| + |a||c| + |b||c|) + d^2 * (|a| + |b| + |c|) + d^3) / 6
+
+// (a vertex set of) 16-bit coordinates, quantized within an aabb
+class quantized_vertex_set
+{
+public:
+	typedef vertex_t value_type;
+	typedef by_value_iterator<quantized_vertex_set> const_iterator;
+
+	static constexpr uint16_t levels = std::numeric_limits<uint16_t>::max();
+
+private:
+	coord_t origin[3] = { 0, 0, 0 };
+	coord_t step[3] = { 0, 0, 0 };
+	std::vector<std::array<uint16_t, 3>> data;
+
+	uint16_t quantize(const coord_t c, const int axis) const
+	{
+		if(step[axis] == 0)
+		{
+			return 0;
+		}
+		const coord_t q = std::round((c - origin[axis]) / step[axis]);
+		return uint16_t(std::min<coord_t>(std::max<coord_t>(q, 0), levels));
+	}
+
+public:
+	quantized_vertex_set() {}
+
+	// two passes over the vertices: one to determine the aabb, one to quantize
+	template<typename It>
+	quantized_vertex_set(const It begin, const It end)
+	{
+		coord_t mn[3] = {
+			std::numeric_limits<coord_t>::infinity(),
+			std::numeric_limits<coord_t>::infinity(),
+			std::numeric_limits<coord_t>::infinity() };
+		coord_t mx[3] = { -mn[0], -mn[1], -mn[2] };
+		size_t n = 0;
+		for(It it = begin; it != end; it++, n++)
+		{
+			const vertex_t v = to_vertex(*it);
+			mn[0] = std::min(mn[0], v.x());
+			mn[1] = std::min(mn[1], v.y());
+			mn[2] = std::min(mn[2], v.z());
+			mx[0] = std::max(mx[0], v.x());
+			mx[1] = std::max(mx[1], v.y());
+			mx[2] = std::max(mx[2], v.z());
+		}
+		if(n == 0)
+		{
+			return;
+		}
+		for(int a = 0; a < 3; a++)
+		{
+			origin[a] = mn[a];
+			step[a] = (mx[a] - mn[a]) / levels;
+		}
+
+		data.reserve(n);
+		for(It it = begin; it != end; it++)
+		{
+			const vertex_t v = to_vertex(*it);
+			data.push_back( { {
+				quantize(v.x(), 0),
+				quantize(v.y(), 1),
+				quantize(v.z(), 2) } } );
+		}
+	}
+
+	const size_t size() const { return data.size(); }
+	const bool empty() const { return data.empty(); }
+
+	const value_type operator[](const size_t i) const
+	{
+		return value_type(std::make_tuple(
+			origin[0] + data[i][0] * step[0],
+			origin[1] + data[i][1] * step[1],
+			origin[2] + data[i][2] * step[2]));
+	}
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	// largest error per axis on a coordinate (half a step)
+	const vertex_t max_error() const
+	{
+		return vertex_t(std::make_tuple(step[0] / 2, step[1] / 2, step[2] / 2));
+	}
+};
+
+typedef precision<float, uint32_t>				single_precision;
+typedef precision<uint16_t, uint32_t, quantized_vertex_set>	quantized_precision;
+
+typedef single_precision::model_type				float_model_t;
+typedef quantized_precision::model_type				quantized_model_t;
+
+// copies the vertices into whatever the policy stores
+template<typename VST>
+struct convert_vertices
+{
+	template<typename It>
+	static VST from(const It begin, const It end)
+	{
+		return VST(begin, end);
+	}
+};
+
+template<typename CT>
+struct convert_vertices<std::vector<vertex3d<CT, std::tuple<CT, CT, CT>>>>
+{
+	template<typename It>
+	static std::vector<vertex3d<CT, std::tuple<CT, CT, CT>>> from(It begin, const It end)
+	{
+		std::vector<vertex3d<CT, std::tuple<CT, CT, CT>>> res;
+		res.reserve(std::distance(begin, end));
+		for(; begin != end; begin++)
+		{
+			const vertex_t v = to_vertex(*begin);
+			res.push_back(std::make_tuple(CT(v.x()), CT(v.y()), CT(v.z())));
+		}
+		return res;
+	}
+};
+
+// the same model, stored as policy P prescribes
+// (throws std::length_error if there are more vertices than P::index_type can count)
+template<typename P, typename VST, typename MT>
+typename P::model_type convert(const model<VST, MT>& m)
+{
+	typedef typename P::index_type IT;
+
+	if(m.vertex_set().size() > std::numeric_limits<IT>::max())
+	{
+		throw std::length_error("convert: too many vertices for the index type");
+	}
+	typename P::model_type res;
+	res.vertex_set() = convert_vertices<typename P::vertex_set_type>::from(
+		m.vertex_set().begin(), m.vertex_set().end());
+	res.mesh().reserve(m.mesh().size());
+	for(const auto& f: m.mesh())
+	{
+		res.mesh().push_back(std::make_tuple(IT(f.a()), IT(f.b()), IT(f.c())));
+	}
+	return res;
+}
+
+#endif // PRECISION_HEADER_FILE
@@ -0,0 +1,610 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "server.hxx"
+#include "cache.hxx"
+#include "../parser/parser.hxx"
+
+// longest query that is read
+static const size_t max_query = size_t(1) << 16;
+
+// reads and measures the OBJ file at path (nullptr if it can't be opened)
+static model_cache::entry_t load_model(
+	const std::string& path,
+	const uint64_t size,
+	const int64_t mtime,
+	const unsigned threads)
+{
+	mapped_file in(path);
+	if(!in.is_open())
+	{
+		return nullptr;
+	}
+
+	std::ostringstream log; // (nobody to show the warnings to)
+	auto res = parse(in, parse_mode::single_pass, threads, log);
+	const mesh_stats stats = calculate_mesh_stats(std::get<0>(res), threads);
+	const std::shared_ptr<loaded_model> m = std::make_shared<loaded_model>(loaded_model {
+		std::move(std::get<0>(res)),
+		stats,
+		aabb(stats.range()),
+		std::get<1>(res),
+		std::get<2>(res),
+		size,
+		mtime,
+		0 });
+	m -> bytes = sizeof(loaded_model) + path.size()
+		+ m -> model.vertex_set().capacity() * sizeof(vertex_t)
+		+ m -> model.mesh().capacity() * sizeof(face_t);
+	return m;
+}
+
+model_cache::model_cache(const size_t budget, const unsigned threads)
+: budget(budget), threads(std::max(1u, threads)) {}
+
+void model_cache::remove(const std::unordered_map<std::string, std::list<slot>::iterator>::iterator it)
+{
+	totals.bytes -= it -> second -> entry -> bytes;
+	lru.erase(it -> second);
+	index.erase(it);
+}
+
+void model_cache::evict()
+{
+	while(totals.bytes > budget && !lru.empty())
+	{
+		remove(index.find(lru.back().path));
+		totals.evictions++;
+	}
+}
+
+model_cache::entry_t model_cache::get(const std::string& path)
+{
+	std::error_code ec;
+	const uint64_t size = std::filesystem::file_size(path, ec);
+	if(ec)
+	{
+		return nullptr;
+	}
+	const int64_t mtime = source_mtime(path);
+
+	std::promise<entry_t> promise;
+	std::shared_future<entry_t> pending;
+	{
+		std::lock_guard<std::mutex> l(lock);
+		const auto it = index.find(path);
+		if(it != index.end())
+		{
+			if(it -> second -> entry -> size == size && it -> second -> entry -> mtime == mtime)
+			{
+				totals.hits++;
+				lru.splice(lru.begin(), lru, it -> second);
+				return it -> second -> entry;
+			}
+			remove(it);
+		}
+
+		// (read by another thread right now)
+		const auto ld = loading.find(path);
+		if(ld != loading.end())
+		{
+			totals.hits++;
+			pending = ld -> second;
+		}
+		else
+		{
+			totals.misses++;
+			loading.emplace(path, promise.get_future().share());
+		}
+	}
+	if(pending.valid())
+	{
+		return pending.get();
+	}
+
+	entry_t e;
+	try
+	{
+		e = load_model(path, size, mtime, threads);
+	}
+	catch(...)
+	{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			loading.erase(path);
+		}
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> l(lock);
+		loading.erase(path);
+		if(e && e -> bytes <= budget)
+		{
+			const auto it = index.find(path);
+			if(it != index.end())
+			{
+				remove(it);
+			}
+			lru.push_front( { path, e } );
+			index.emplace(path, lru.begin());
+			totals.bytes += e -> bytes;
+			evict();
+		}
+	}
+	promise.set_value(e);
+	return e;
+}
+
+void model_cache::drop(const std::string& path)
+{
+	std::lock_guard<std::mutex> l(lock);
+	const auto it = index.find(path);
+	if(it != index.end())
+	{
+		remove(it);
+	}
+}
+
+const model_cache::counts model_cache::stats() const
+{
+	std::lock_guard<std::mutex> l(lock);
+	counts c = totals;
+	c.entries = lru.size();
+	return c;
+}
+
+// the address of the socket at path (false if the path is too long)
+static bool socket_address(const std::string& path, sockaddr_un& addr)
+{
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(path.empty() || path.size() >= sizeof(addr.sun_path))
+	{
+		return false;
+	}
+	std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+
+static bool send_all(const int fd, const std::string& s)
+{
+	for(size_t done = 0; done < s.size(); )
+	{
+		const ssize_t n = ::send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			return false;
+		}
+		done += size_t(n);
+	}
+	return true;
+}
+
+// takes the first complete line (without its end) out of buf, if there is one
+static bool take_line(std::string& buf, std::string& line)
+{
+	const size_t eol = buf.find('\n');
+	if(eol == std::string::npos)
+	{
+		return false;
+	}
+	line.assign(buf, 0, eol);
+	buf.erase(0, eol + 1);
+	if(!line.empty() && line.back() == '\r')
+	{
+		line.pop_back();
+	}
+	return true;
+}
+
+// the next line (without its end) from fd, with what was read after it
+// left in buf. false at the end of the connection or on a line that is too long
+static bool receive_line(const int fd, std::string& buf, std::string& line)
+{
+	char chunk[4096];
+	for(;;)
+	{
+		if(take_line(buf, line))
+		{
+			return true;
+		}
+		if(buf.size() > max_query)
+		{
+			return false;
+		}
+		const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			return false;
+		}
+		buf.append(chunk, size_t(n));
+	}
+}
+
+model_server::model_server(const std::string& socket_path, const server_options& opt)
+: path(socket_path), cache(opt.memory, opt.parse_threads), workers(std::max(1u, opt.workers)),
+	listener(-1), stopping(false), wake { -1, -1 }
+{
+	sockaddr_un addr;
+	if(!socket_address(path, addr) || ::pipe2(wake, O_CLOEXEC | O_NONBLOCK) != 0)
+	{
+		return;
+	}
+
+	// a socket that nobody answers on anymore is left over, it is replaced
+	const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(probe < 0)
+	{
+		return;
+	}
+	const bool taken = ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+	::close(probe);
+	if(taken)
+	{
+		return;
+	}
+	struct stat st;
+	if(::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+	{
+		::unlink(path.c_str());
+	}
+
+	listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(listener < 0)
+	{
+		return;
+	}
+	if(::bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0
+		|| ::listen(listener, SOMAXCONN) != 0)
+	{
+		::close(listener);
+		listener = -1;
+	}
+}
+
+model_server::~model_server()
+{
+	if(listener >= 0)
+	{
+		::close(listener);
+		::unlink(path.c_str());
+	}
+	for(const int fd: wake)
+	{
+		if(fd >= 0)
+		{
+			::close(fd);
+		}
+	}
+}
+
+const bool model_server::is_open() const
+{ return listener >= 0; }
+
+const model_cache& model_server::models() const
+{ return cache; }
+
+void model_server::wake_up()
+{
+	const char c = 0;
+	if(::write(wake[1], &c, 1) < 0)
+	{
+		// (full: it is woken up already)
+	}
+}
+
+void model_server::stop()
+{
+	{
+		std::lock_guard<std::mutex> l(lock);
+		stopping = true;
+	}
+	has_work.notify_all();
+	wake_up();
+}
+
+void model_server::run()
+{
+	if(!is_open())
+	{
+		return;
+	}
+
+	std::vector<std::thread> pool;
+	for(unsigned i = 0; i < workers; i++)
+	{
+		pool.emplace_back([ this ] ()
+		{
+			for(;;)
+			{
+				std::pair<int, std::string> job;
+				{
+					std::unique_lock<std::mutex> l(lock);
+					has_work.wait(l, [ this ] () { return stopping || !jobs.empty(); });
+					if(stopping)
+					{
+						return;
+					}
+					job = std::move(jobs.front());
+					jobs.pop_front();
+				}
+				const bool sent = send_all(job.first, answer(job.second) + "\n");
+				{
+					std::lock_guard<std::mutex> l(lock);
+					answered.emplace_back(job.first, sent);
+				}
+				wake_up();
+			}
+		});
+	}
+
+	// what was read from a connection, and whether it has a query in the pool
+	// (then it isn't read from, nor closed)
+	struct connection
+	{
+		std::string buf;
+		bool busy = false;
+	};
+	std::unordered_map<int, connection> conns;
+
+	// hands the next query of fd to the pool, if it has a complete one.
+	// false if the connection is to be closed
+	const auto next = [ this ] (const int fd, connection& c)
+	{
+		std::string query;
+		if(!take_line(c.buf, query))
+		{
+			return c.buf.size() <= max_query;
+		}
+		if(query == "quit")
+		{
+			return false;
+		}
+		c.busy = true;
+		{
+			std::lock_guard<std::mutex> l(lock);
+			jobs.emplace_back(fd, std::move(query));
+		}
+		has_work.notify_one();
+		return true;
+	};
+	const auto close_connection = [ &conns ] (const int fd)
+	{
+		::close(fd);
+		conns.erase(fd);
+	};
+
+	std::vector<pollfd> polled;
+	while(!stopping)
+	{
+		polled.clear();
+		polled.push_back( { listener, POLLIN, 0 } );
+		polled.push_back( { wake[0], POLLIN, 0 } );
+		for(const auto& c: conns)
+		{
+			if(!c.second.busy)
+			{
+				polled.push_back( { c.first, POLLIN, 0 } );
+			}
+		}
+		if(::poll(polled.data(), polled.size(), -1) < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		// connections whose answer was sent can go on
+		if(polled[1].revents != 0)
+		{
+			char drain[64];
+			while(::read(wake[0], drain, sizeof(drain)) > 0);
+			std::vector<std::pair<int, bool>> done;
+			{
+				std::lock_guard<std::mutex> l(lock);
+				done.swap(answered);
+			}
+			for(const std::pair<int, bool>& d: done)
+			{
+				connection& c = conns[d.first];
+				c.busy = false;
+				if(!(d.second && next(d.first, c)))
+				{
+					close_connection(d.first);
+				}
+			}
+		}
+
+		char chunk[4096];
+		for(size_t i = 2; i < polled.size(); i++)
+		{
+			if(polled[i].revents == 0)
+			{
+				continue;
+			}
+			const int fd = polled[i].fd;
+			const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			connection& c = conns[fd];
+			if(n > 0)
+			{
+				c.buf.append(chunk, size_t(n));
+			}
+			if(n <= 0 || !next(fd, c))
+			{
+				close_connection(fd);
+			}
+		}
+
+		if(polled[0].revents != 0)
+		{
+			const int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+			if(fd >= 0)
+			{
+				// (a client that doesn't read its answers can't hold a worker for long)
+				const timeval timeout = { 5, 0 };
+				::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+				conns[fd];
+			}
+		}
+	}
+
+	stop();
+	for(std::thread& t: pool)
+	{
+		t.join();
+	}
+	for(const auto& c: conns)
+	{
+		::close(c.first);
+	}
+	jobs.clear();
+	answered.clear();
+	::close(listener);
+	::unlink(path.c_str());
+	listener = -1;
+}
+
+std::string model_server::answer(const std::string& query)
+{
+	std::istringstream words(query);
+	std::string cmd;
+	std::vector<std::string> args;
+	words >> cmd;
+	for(std::string w; words >> w; )
+	{
+		args.push_back(w);
+	}
+
+	try
+	{
+		if(cmd == "status" && args.empty())
+		{
+			const model_cache::counts c = cache.stats();
+			std::ostringstream out;
+			out << "ok entries " << c.entries << " bytes " << c.bytes << " hits " << c.hits
+				<< " misses " << c.misses << " evictions " << c.evictions;
+			return out.str();
+		}
+		if(cmd == "shutdown" && args.empty())
+		{
+			stop();
+			return "ok";
+		}
+		if(cmd == "drop" && args.size() == 1)
+		{
+			cache.drop(args[0]);
+			return "ok";
+		}
+
+		const bool one = cmd == "bounds" || cmd == "surface" || cmd == "volume" || cmd == "stats";
+		if(!((one && args.size() == 1) || (cmd == "overlap" && args.size() == 2)))
+		{
+			return "error unknown query '" + query + "'";
+		}
+
+		std::vector<model_cache::entry_t> m;
+		for(const std::string& a: args)
+		{
+			m.push_back(cache.get(a));
+			if(!m.back())
+			{
+				return "error can't read '" + a + "'";
+			}
+			if(!(m.back() -> syntax && m.back() -> model.mesh().size() > 0))
+			{
+				return "error unable to extract model from '" + a + "'";
+			}
+		}
+
+		std::ostringstream out;
+		out << std::setprecision(std::numeric_limits<scalar_t>::max_digits10) << "ok";
+		const aabb& box = m[0] -> box;
+		if(cmd == "overlap")
+		{
+			out << " " << std::boolalpha << (box && m[1] -> box);
+			return out.str();
+		}
+		if(cmd == "stats")
+		{
+			out << " " << m[0] -> model.vertex_set().size() << " " << m[0] -> model.mesh().size();
+		}
+		if(cmd == "bounds" || cmd == "stats")
+		{
+			out << " " << box.min_x() << " " << box.min_y() << " " << box.min_z()
+				<< " " << box.max_x() << " " << box.max_y() << " " << box.max_z();
+		}
+		if(cmd == "surface" || cmd == "stats")
+		{
+			out << " " << m[0] -> stats.surface();
+		}
+		if(cmd == "volume" || cmd == "stats")
+		{
+			out << " " << m[0] -> stats.volume();
+		}
+		return out.str();
+	}
+	catch(const std::exception& e)
+	{
+		return std::string("error ") + e.what();
+	}
+}
+
+std::optional<std::string> send_query(const std::string& socket_path, const std::string& query)
+{
+	sockaddr_un addr;
+	if(!socket_address(socket_path, addr))
+	{
+		return std::nullopt;
+	}
+	const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0)
+	{
+		return std::nullopt;
+	}
+
+	std::string buf;
+	std::string line;
+	const bool ok =
+		::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0
+		&& send_all(fd, query + "\n")
+		&& receive_line(fd, buf, line);
+	::close(fd);
+	if(!ok)
+	{
+		return std::nullopt;
+	}
+	return line;
+}
@@ -0,0 +1,161 @@
+#ifndef SERVER_HEADER_FILE
+#define SERVER_HEADER_FILE
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.hxx"
+#include "bbox.hxx"
+#include "parallel.hxx"
+#include "../algo/stats.hxx"
+
+///////////////////////////////////////////
+//       model server (daemon mode)      //
+///////////////////////////////////////////
+
+// a parsed OBJ file, as the server keeps it
+struct loaded_model
+{
+	model_t model;
+	mesh_stats stats;
+	aabb box;
+	bool syntax;
+	bool semantics;
+	uint64_t size;  // of the file when it was read...
+	int64_t mtime;  // ...and its mtime (see source_mtime)
+	size_t bytes;   // memory the model takes
+};
+
+// the models of the files that were asked for, most recently used first.
+// when they take more than 'budget' bytes together, the least recently used
+// ones are dropped (a model that takes more than the budget on its own is
+// handed out, but not kept). a model is only handed out as long as its file
+// has the size and mtime it had when it was read, otherwise it is read again.
+// a file that is asked for on several threads at the same time is read once.
+// the models are shared: a model that is dropped stays valid for as long as
+// a thread holds on to it.
+class model_cache
+{
+public:
+	typedef std::shared_ptr<const loaded_model> entry_t;
+
+	struct counts
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;    // (the file was read)
+		uint64_t evictions = 0; // (dropped to stay within the budget)
+		size_t entries = 0;
+		size_t bytes = 0;
+	};
+
+private:
+	struct slot
+	{
+		std::string path;
+		entry_t entry;
+	};
+
+	const size_t budget;
+	const unsigned threads; // used to parse a file
+	mutable std::mutex lock;
+	std::list<slot> lru;
+	std::unordered_map<std::string, std::list<slot>::iterator> index;
+	std::unordered_map<std::string, std::shared_future<entry_t>> loading;
+	counts totals;
+
+	// (with the lock held)
+	void remove(const std::unordered_map<std::string, std::list<slot>::iterator>::iterator it);
+	void evict();
+
+public:
+	model_cache(const size_t budget, const unsigned threads = 1);
+
+	// the model of the OBJ file at path (nullptr if it can't be read)
+	entry_t get(const std::string& path);
+	// forgets the model of the file at path
+	void drop(const std::string& path);
+	const counts stats() const;
+};
+
+struct server_options
+{
+	size_t memory = size_t(1) << 30;      // see model_cache
+	unsigned workers = default_threads(); // queries answered at the same time
+	unsigned parse_threads = 1;           // per file that is read
+};
+
+// answers queries on the models of OBJ files, on a Unix (stream) socket
+//
+// A query is a line, its answer is a line that starts with "ok" or "error".
+// A connection can send any number of queries, they are answered in order.
+// Words are separated by blanks (so a path can't hold one); relative paths
+// are relative to the working directory of the server.
+//   bounds FILE     ok min_x min_y min_z max_x max_y max_z
+//   surface FILE    ok surface
+//   volume FILE     ok volume
+//   stats FILE      ok vertices faces min_x min_y min_z max_x max_y max_z surface volume
+//   overlap A B     ok true|false (whether the aabb's of A and B intersect)
+//   drop FILE       ok (the model is read again next time)
+//   status          ok entries N bytes N hits N misses N evictions N
+//   quit            (closes the connection)
+//   shutdown        ok (stops the server)
+// A file whose syntax is wrong, or that has no faces, is an error (as in
+// demo, the models of files with semantic errors are used).
+//
+// One thread (the one in run()) accepts the connections and reads from all
+// of them (poll), every complete query is answered by one of a pool of
+// server_options::workers threads: an idle or slow client doesn't hold a
+// worker. A connection has one query at a time in the pool, so its answers
+// come in order. The models are kept in a model_cache.
+class model_server
+{
+private:
+	const std::string path;
+	model_cache cache;
+	const unsigned workers;
+	int listener;
+	std::atomic<bool> stopping;
+	std::mutex lock;
+	std::condition_variable has_work;
+	std::deque<std::pair<int, std::string>> jobs;  // queries (and their connection) to answer
+	std::vector<std::pair<int, bool>> answered;    // connections whose query is answered (and whether the answer was sent)
+	int wake[2];                                   // pipe: wakes up the thread in run()
+
+	void wake_up();
+
+public:
+	// listens on a socket at socket_path (a stale socket there is replaced)
+	model_server(const std::string& socket_path, const server_options& opt = server_options());
+	~model_server();
+
+	model_server(const model_server&) = delete;
+	const model_server& operator=(const model_server&) = delete;
+
+	// whether the socket is set up
+	const bool is_open() const;
+	// serves connections until stop() (or a shutdown query)
+	void run();
+	// (may be called from any thread)
+	void stop();
+
+	// the answer to one query (without the end of line)
+	std::string answer(const std::string& query);
+	const model_cache& models() const;
+};
+
+// sends a query to the server at socket_path, returns its answer
+// (nothing if the server can't be reached)
+std::optional<std::string> send_query(const std::string& socket_path, const std::string& query);
+
+#endif // SERVER_HEADER_FILE
@@ -0,0 +1,108 @@
+#ifndef SOA_HEADER_FILE
+#define SOA_HEADER_FILE
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "types.hxx"
+
+// allocator handing out memory aligned on A bytes (for SIMD loads)
+template<typename T, size_t A>
+struct aligned_allocator
+{
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind { typedef aligned_allocator<U, A> other; };
+
+	aligned_allocator() {}
+	template<typename U>
+	aligned_allocator(const aligned_allocator<U, A>&) {}
+
+	T* allocate(const size_t n)
+	{ return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(A))); }
+
+	void deallocate(T* p, const size_t)
+	{ ::operator delete(p, std::align_val_t(A)); }
+
+	template<typename U>
+	const bool operator==(const aligned_allocator<U, A>&) const { return true; }
+	template<typename U>
+	const bool operator!=(const aligned_allocator<U, A>&) const { return false; }
+};
+
+// vertex set as a structure of arrays: all x coordinates, then all y's, then all z's,
+// each array aligned on a cache line. Vertices are handed out by value.
+template<typename CT>
+class soa_vertex_set
+{
+public:
+	typedef vertex3d<CT, std::tuple<CT, CT, CT>> value_type;
+	typedef std::vector<CT, aligned_allocator<CT, 64>> array_t;
+
+	typedef by_value_iterator<soa_vertex_set> const_iterator;
+
+private:
+	array_t xs;
+	array_t ys;
+	array_t zs;
+
+public:
+	soa_vertex_set() {}
+
+	template<typename It>
+	soa_vertex_set(It begin, const It end)
+	{
+		reserve(std::distance(begin, end));
+		for(; begin != end; begin++)
+		{
+			push_back(*begin);
+		}
+	}
+
+	template<typename VT>
+	void push_back(const VT& v)
+	{
+		xs.push_back(v.x());
+		ys.push_back(v.y());
+		zs.push_back(v.z());
+	}
+
+	void reserve(const size_t n)
+	{
+		xs.reserve(n);
+		ys.reserve(n);
+		zs.reserve(n);
+	}
+
+	const size_t size() const { return xs.size(); }
+	const bool empty() const { return xs.empty(); }
+
+	const value_type operator[](const index_t i) const
+	{ return value_type(std::make_tuple(xs[i], ys[i], zs[i])); }
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	const CT* x_data() const { return xs.data(); }
+	const CT* y_data() const { return ys.data(); }
+	const CT* z_data() const { return zs.data(); }
+	CT* x_data() { return xs.data(); }
+	CT* y_data() { return ys.data(); }
+	CT* z_data() { return zs.data(); }
+};
+
+typedef soa_vertex_set<coord_t>					soa_vertex_set_t;
+typedef model<soa_vertex_set_t, mesh_t>				soa_model_t;
+
+// same model, vertices stored as structure of arrays
+inline soa_model_t to_soa(const model_t& m)
+{
+	soa_model_t res;
+	res.vertex_set() = soa_vertex_set_t(m.vertex_set().begin(), m.vertex_set().end());
+	res.mesh() = m.mesh();
+	return res;
+}
+
+#endif // SOA_HEADER_FILE
@@ -0,0 +1,361 @@
+#ifndef STREAM_HEADER_FILE
+#define STREAM_HEADER_FILE
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "types.hxx"
+#include "instrument.hxx"
+#include "../parser/scanner.hxx"
+#include "../parser/builder.hxx"
+#include "../algo/stats.hxx"
+
+///////////////////////////////////////////
+//        streaming statistics           //
+///////////////////////////////////////////
+
+// The statistics of a model (see calculate_mesh_stats), without building the
+// model: the OBJ file is read a buffer at a time and every face is added to
+// the statistics as soon as it is read. Only the coordinates of the vertices
+// are kept, in memory up to a budget and beyond that in a (memory-mapped)
+// temporary file.
+
+namespace interprocess = boost::interprocess;
+
+// the coordinates of the vertices read so far. they stay in memory as long as
+// they fit in 'budget' bytes, then they all move to a temporary file (which
+// doubles in size whenever it is full), so the operating system decides which
+// parts are in memory. the file is removed when the store is destroyed.
+class vertex_store final
+{
+private:
+	size_t budget;
+	size_t n = 0;
+	std::vector<coord_t> mem;
+	boost::filesystem::path path; // of the file, empty as long as nothing is spilled
+	interprocess::file_mapping mapping;
+	interprocess::mapped_region region;
+	size_t capacity = 0;          // vertices that fit in the file
+
+	// (re)maps the file at a size of cap vertices
+	bool spill(const size_t cap)
+	{
+		try
+		{
+			if(path.empty())
+			{
+				path = boost::filesystem::temp_directory_path()
+					/ boost::filesystem::unique_path("obj-vertices-%%%%-%%%%-%%%%");
+				std::ofstream create(path.string(), std::ios::binary);
+				if(!create)
+				{
+					path.clear();
+					return false;
+				}
+			}
+			region = interprocess::mapped_region();
+			boost::filesystem::resize_file(path, cap * 3 * sizeof(coord_t));
+			mapping = interprocess::file_mapping(path.string().c_str(), interprocess::read_write);
+			region = interprocess::mapped_region(mapping, interprocess::read_write);
+		}
+		catch(const interprocess::interprocess_exception&) { return false; }
+		catch(const boost::filesystem::filesystem_error&) { return false; }
+
+		if(!mem.empty())
+		{
+			std::memcpy(region.get_address(), mem.data(), mem.size() * sizeof(coord_t));
+			std::vector<coord_t>().swap(mem);
+		}
+		capacity = cap;
+		return true;
+	}
+
+	const coord_t* data() const
+	{
+		return path.empty() ? mem.data() : static_cast<const coord_t*>(region.get_address());
+	}
+
+public:
+	vertex_store(const size_t budget) : budget(budget) {}
+
+	~vertex_store()
+	{
+		if(!path.empty())
+		{
+			region = interprocess::mapped_region();
+			mapping = interprocess::file_mapping();
+			boost::system::error_code ec;
+			boost::filesystem::remove(path, ec);
+		}
+	}
+
+	vertex_store(const vertex_store&) = delete;
+	const vertex_store& operator=(const vertex_store&) = delete;
+
+	// returns false if the vertex could not be stored (the temporary file
+	// could not be created or grown)
+	bool push_back(const vertex_t& v)
+	{
+		if(path.empty() && (n + 1) * 3 > budget / sizeof(coord_t))
+		{
+			if(!spill(std::max<size_t>(n * 2, 1 << 12)))
+			{
+				return false;
+			}
+		}
+		else if(!path.empty() && n == capacity)
+		{
+			if(!spill(capacity * 2))
+			{
+				return false;
+			}
+		}
+
+		if(path.empty())
+		{
+			// don't let the vector grow beyond the budget
+			if(mem.size() == mem.capacity())
+			{
+				mem.reserve(std::min(
+					std::max<size_t>(mem.capacity() * 2, 3 << 10),
+					budget / sizeof(coord_t) / 3 * 3));
+			}
+			mem.push_back(v.x());
+			mem.push_back(v.y());
+			mem.push_back(v.z());
+		}
+		else
+		{
+			coord_t* p = static_cast<coord_t*>(region.get_address()) + 3 * n;
+			p[0] = v.x();
+			p[1] = v.y();
+			p[2] = v.z();
+		}
+		n++;
+		return true;
+	}
+
+	const vertex_t operator[](const index_t i) const
+	{
+		const coord_t* p = data() + 3 * i;
+		return vertex_t(std::make_tuple(p[0], p[1], p[2]));
+	}
+
+	const size_t size() const { return n; }
+
+	// the vertices are in a file
+	const bool spilled() const { return !path.empty(); }
+};
+
+// scanner sink of stream_stats: one pass over the file.
+// faces are treated as model_builder and build_model would: the same faces
+// are dropped (with the same warnings), the same vertices are used.
+// a face that points to a vertex that is not read yet (a forward reference)
+// can only be handled once the number of vertices is known: when that is not
+// known (total is invalid), the pass gives up on faces (forward is set).
+// the warnings of faces with too few or too many vertices go to log right
+// away, those of bad indices come after all of them (as with model_builder):
+// the first late_limit of those are kept until the end of the pass (see
+// write_late), the others are only counted.
+struct stats_pass
+{
+	static const size_t late_limit = size_t(1) << 12;
+
+	vertex_store& store;
+	const bool keep;            // store the vertices (otherwise they are in the store already)
+	const index_t total;        // vertices in the file, invalid if not known
+	index_t count = 0;          // vertices read so far
+	int f_i = 0;
+	index_t faces = 0;          // valid faces
+	bool forward = false;
+	bool dropped = false;
+	bool failed = false;        // the store failed
+	std::vector<bool> used;
+	index_t used_count = 0;
+	mesh_stats block;           // the stats_block faces being read
+	stats_reducer reducer;
+	std::ostream& log;
+	const int quiet;            // faces whose warnings an earlier pass wrote
+	std::ostringstream late;    // warnings of bad indices
+	size_t late_count = 0;      // faces with bad indices
+
+	stats_pass(vertex_store& s, const bool keep, const index_t total, std::ostream& log, const int quiet = 0)
+	: store(s), keep(keep), total(total), log(log), quiet(quiet) {}
+
+	void vertex(const ast_vert& v)
+	{
+		if(keep && !failed && !store.push_back(vertex_t(std::make_tuple(v.num[0], v.num[1], v.num[2]))))
+		{
+			failed = true;
+		}
+		used.push_back(false);
+		count++;
+	}
+
+	void face(const ast_face& fc)
+	{
+		if(forward || failed)
+		{
+			return;
+		}
+		f_i++;
+		if(fc.n != 3)
+		{
+			if(f_i > quiet)
+			{
+				log << "**Warning: too many or too few vertices in face " << f_i << " (ignoring this face)\n";
+			}
+			dropped = true;
+			return;
+		}
+
+		index_t idx[3];
+		model_builder::resolve(fc, count, idx);
+		const index_t limit = total == model_builder::invalid ? count : total;
+		for(int i = 0; i < 3; i++)
+		{
+			if(idx[i] >= limit)
+			{
+				if(total == model_builder::invalid && fc.num[i] > 0)
+				{
+					forward = true;
+					return;
+				}
+				if(late_count++ < late_limit)
+				{
+					late
+						<< "**Warning: index "
+						<< fc.num[i]
+						<< " not pointing to valid vertex for face "
+						<< f_i << "\n"
+						<< "**Warning: ignoring face "
+						<< f_i
+						<< " due to aformentioned error(s)\n";
+				}
+				dropped = true;
+				return;
+			}
+			// (the indices before a bad one are used, as in model_builder::finish)
+			if(!used[idx[i]])
+			{
+				used[idx[i]] = true;
+				used_count++;
+			}
+		}
+
+		block.add_face(store[idx[0]], store[idx[1]], store[idx[2]]);
+		if(++faces % stats_block == 0)
+		{
+			reducer.push(block);
+			block = mesh_stats();
+		}
+	}
+
+	// writes the warnings of bad indices to log
+	void write_late()
+	{
+		log << late.str();
+		if(late_count > late_limit)
+		{
+			log << "**Warning: " << (late_count - late_limit)
+				<< " more faces ignored due to indices not pointing to valid vertices\n";
+		}
+	}
+
+	// the statistics of the used vertices and the valid faces
+	mesh_stats finish()
+	{
+		if(faces % stats_block != 0)
+		{
+			reducer.push(block);
+		}
+		mesh_stats res = reducer.result();
+		for(index_t i = 0; i < used.size(); i++)
+		{
+			if(used[i])
+			{
+				res.add_vertex(store[i]);
+			}
+		}
+		INSTRUMENT_COUNT(vertices_read, count);
+		INSTRUMENT_COUNT(vertices_unused, count - used_count);
+		INSTRUMENT_COUNT(faces_read, f_i);
+		INSTRUMENT_COUNT(faces_accepted, faces);
+		INSTRUMENT_COUNT(faces_dropped, f_i - faces);
+		return res;
+	}
+};
+
+// statistics of the OBJ file at path, read buffer_size bytes at a time, with
+// (about) memory_budget bytes of vertex coordinates in memory. exactly the
+// same as calculate_mesh_stats of the model parse() makes of it.
+// besides that the memory use grows with one bit per vertex and with the
+// longest line (and up to stats_pass::late_limit warnings). a file with forward references to vertices is read twice.
+// returns the statistics, whether the syntax and the semantics are correct
+// (see parse()) and the number of faces of the model. warnings go to log.
+inline std::tuple<mesh_stats, bool, bool, index_t> stream_stats(
+	const std::string& path,
+	const size_t memory_budget = size_t(256) << 20,
+	const size_t buffer_size = size_t(1) << 20,
+	std::ostream& log = std::cerr)
+{
+	// (the statistics are calculated while scanning)
+	INSTRUMENT_TIMER(parse);
+	const std::tuple<mesh_stats, bool, bool, index_t> fail(mesh_stats(), false, false, 0);
+
+	vertex_store store(memory_budget);
+	std::ifstream in(path, std::ios::binary);
+	if(!in)
+	{
+		log << "**Error: can't open '" << path << "'\n";
+		return fail;
+	}
+
+	stats_pass first(store, true, model_builder::invalid, log);
+	if(!scanner::scan(in, buffer_size, first))
+	{
+		return fail;
+	}
+	if(first.failed)
+	{
+		log << "**Error: can't store the vertices of '" << path << "'\n";
+		return fail;
+	}
+	if(!first.forward)
+	{
+		first.write_late();
+		return std::make_tuple(
+			first.finish(),
+			true,
+			!first.dropped && first.used_count == first.count,
+			first.faces);
+	}
+
+	// all vertices are stored: read the faces again
+	stats_pass second(store, false, first.count, log, first.f_i);
+	in.clear();
+	in.seekg(0);
+	if(!scanner::scan(in, buffer_size, second))
+	{
+		return fail;
+	}
+	second.write_late();
+	return std::make_tuple(
+		second.finish(),
+		true,
+		!second.dropped && second.used_count == second.count,
+		second.faces);
+}
+
+#endif // STREAM_HEADER_FILE
@@ -2,6 +2,9 @@
 #define TYPES_HEADER_FILE
 
 #include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
 #include <vector>
 #include <tuple>
 #include <utility>
@@ -29,7 +32,7 @@ public:
 		const super_t& u = *(static_cast<const SuperT*>(this));
 		return { { // assume coords can be initialized with init-lists
 			u.y() * v.z() - u.z() * v.y(),
-			u.x() * v.z() - u.z() * v.x(),
+			u.z() * v.x() - u.x() * v.z(),
 			u.x() * v.y() - u.y() * v.x()
 		} };
 	}
@@ -193,14 +196,85 @@ public:
 	const VST& vertex_set() const { return vertices; }
 };
 
-typedef vertex3d<coord_t, std::tuple<coord_t, coord_t, coord_t>>
-								vertex_t;
-typedef tri_face<index_t, std::tuple<index_t, index_t, index_t>>
-								face_t;
+// iterator over a container that hands out its elements by value (by index)
+template<typename CT>
+class by_value_iterator
+{
+private:
+	const CT* cont;
+	size_t i;
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef typename CT::value_type value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const value_type* pointer;
+	typedef const value_type reference;
+
+	by_value_iterator(const CT* c, const size_t idx) : cont(c), i(idx) {}
+
+	const value_type operator*() const { return (*cont)[i]; }
+	by_value_iterator& operator++() { i++; return *this; }
+	by_value_iterator operator++(int) { by_value_iterator o(*this); i++; return o; }
+	const bool operator==(const by_value_iterator& o) const { return i == o.i; }
+	const bool operator!=(const by_value_iterator& o) const { return i != o.i; }
+};
+
+// read-only view on an array that lives elsewhere (e.g. in a mapped file)
+template<typename T>
+class array_view
+{
+private:
+	const T* data;
+	size_t n;
+public:
+	typedef T value_type;
+	typedef const T* const_iterator;
+
+	array_view() : data(nullptr), n(0) {}
+	array_view(const T* d, const size_t count) : data(d), n(count) {}
+
+	const size_t size() const { return n; }
+	const bool empty() const { return n == 0; }
+	const T& operator[](const size_t i) const { return data[i]; }
+	const_iterator begin() const { return data; }
+	const_iterator end() const { return data + n; }
+};
+
+// precision policy: what a model stores per coordinate (CT), per vertex index (IT)
+// and how it stores its vertices (VST). whatever is stored, calculations
+// (aabb, surface, volume) are done in scalar_t.
+template<
+	typename CT,
+	typename IT,
+	typename VST = std::vector<vertex3d<CT, std::tuple<CT, CT, CT>>>>
+struct precision
+{
+	typedef CT						coord_type;
+	typedef IT						index_type;
+	typedef vertex3d<CT, std::tuple<CT, CT, CT>>		vertex_type;
+	typedef tri_face<IT, std::tuple<IT, IT, IT>>		face_type;
+	typedef VST						vertex_set_type;
+	typedef std::vector<face_type>				mesh_type;
+	typedef model<vertex_set_type, mesh_type>		model_type;
+};
+
+// the default policy
+typedef precision<coord_t, index_t>				double_precision;
+
+typedef double_precision::vertex_type				vertex_t;
+typedef double_precision::face_type				face_t;
 typedef std::pair<vertex_t, vertex_t>				range_t;
-typedef std::vector<vertex_t>					vertex_set_t;
-typedef std::vector<face_t>					mesh_t;
+typedef double_precision::vertex_set_type			vertex_set_t;
+typedef double_precision::mesh_type				mesh_t;
 //typedef std::pair<vertex_set_t, mesh_t>				model_t;
-typedef model<vertex_set_t, mesh_t>				model_t;
+typedef double_precision::model_type				model_t;
+
+// any stored vertex as one to calculate with
+inline const vertex_t& to_vertex(const vertex_t& v)
+{ return v; }
+
+template<typename V>
+inline const vertex_t to_vertex(const V& v)
+{ return vertex_t(std::make_tuple(scalar_t(v.x()), scalar_t(v.y()), scalar_t(v.z()))); }
 
 #endif // TYPES_HEADER_FILE
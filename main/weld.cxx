@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "weld.hxx"
+#include "instrument.hxx"
+#include "../algo/bounding.hxx"
+#include "../algo/surface.hxx"
+
+// vertices (or faces) per block of work
+static const size_t weld_block = size_t(1) << 14;
+// bits per axis of a cell (and of a Morton code)
+static const int weld_bits = 21;
+
+std::ostream& operator<<(std::ostream& o, const weld_report& r)
+{
+	return o
+		<< r.welded << " of " << r.vertices << " vertices welded, "
+		<< r.unused << " unused, "
+		<< r.degenerate << " degenerate and "
+		<< r.duplicate << " duplicate of " << r.faces << " faces";
+}
+
+// blocks of weld_block items
+template<typename Fn>
+static void for_blocks(const size_t n, const unsigned threads, Fn fn)
+{
+	parallel_for((n + weld_block - 1) / weld_block, threads, [ n, &fn ] (const size_t b)
+	{
+		for(size_t i = b * weld_block; i < std::min(n, (b + 1) * weld_block); i++)
+		{
+			fn(i);
+		}
+	});
+}
+
+// cells of size 'cell' from 'origin' on, weld_bits per axis
+struct cells
+{
+	vertex_t origin;
+	coord_t cell;
+
+	cells(const range_t& box, const coord_t size)
+	: origin(box.first), cell(size)
+	{
+		const vertex_t d = box.first.to(box.second);
+		const coord_t extent = std::max( { d.x(), d.y(), d.z(), coord_t(0) } );
+		cell = std::max(cell, extent / (uint64_t(1) << (weld_bits - 1)));
+		if(!(cell > 0) || !std::isfinite(cell))
+		{
+			cell = 1;
+		}
+	}
+
+	const uint64_t index(const coord_t c, const coord_t o) const
+	{
+		const coord_t i = std::floor((c - o) / cell);
+		const coord_t top = coord_t((uint64_t(1) << weld_bits) - 1);
+		return i >= 0 ? uint64_t(std::min(i, top)) : 0; // (NaN: 0 as well)
+	}
+
+	void at(const vertex_t& v, uint64_t xyz[3]) const
+	{
+		xyz[0] = index(v.x(), origin.x());
+		xyz[1] = index(v.y(), origin.y());
+		xyz[2] = index(v.z(), origin.z());
+	}
+
+	// where c is in cell i along axis (0 at its lower side, 1 at its upper side)
+	const coord_t offset(const coord_t c, const int axis, const uint64_t i) const
+	{
+		const coord_t o = axis == 0 ? origin.x() : (axis == 1 ? origin.y() : origin.z());
+		return (c - o) / cell - coord_t(i);
+	}
+
+	static const uint64_t key(const uint64_t x, const uint64_t y, const uint64_t z)
+	{ return (((x << weld_bits) | y) << weld_bits) | z; }
+};
+
+// interleaves the lower weld_bits bits of x with two zero bits
+static inline uint64_t spread(uint64_t x)
+{
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+static inline const bool finite(const vertex_t& v)
+{ return std::isfinite(v.x()) && std::isfinite(v.y()) && std::isfinite(v.z()); }
+
+// the box of the finite vertices
+static range_t finite_range(const vertex_set_t& vs)
+{
+	range_t r(
+		vertex_t(std::numeric_limits<coord_t>::infinity()),
+		vertex_t(-std::numeric_limits<coord_t>::infinity()));
+	for(const vertex_t& v: vs)
+	{
+		if(finite(v))
+		{
+			r.first = r.first.min(v);
+			r.second = r.second.max(v);
+		}
+	}
+	return r;
+}
+
+// union-find on vertex indices that can be used from several threads:
+// a root is always linked under a smaller one, so whatever the order of the
+// unions, every set ends up with its smallest index as root
+class concurrent_sets
+{
+private:
+	std::vector<std::atomic<index_t>> parent;
+
+public:
+	concurrent_sets(const index_t n) : parent(n)
+	{
+		for(index_t i = 0; i < n; i++)
+		{
+			parent[i].store(i, std::memory_order_relaxed);
+		}
+	}
+
+	index_t find(index_t i)
+	{
+		for(;;)
+		{
+			index_t p = parent[i].load(std::memory_order_relaxed);
+			if(p == i)
+			{
+				return i;
+			}
+			const index_t g = parent[p].load(std::memory_order_relaxed);
+			// (path halving: if another thread got here first, no harm done)
+			parent[i].compare_exchange_weak(p, g, std::memory_order_relaxed);
+			i = g;
+		}
+	}
+
+	void unite(index_t a, index_t b)
+	{
+		for(;;)
+		{
+			a = find(a);
+			b = find(b);
+			if(a == b)
+			{
+				return;
+			}
+			if(a > b)
+			{
+				std::swap(a, b);
+			}
+			index_t expect = b;
+			if(parent[b].compare_exchange_strong(expect, a, std::memory_order_relaxed))
+			{
+				return;
+			}
+		}
+	}
+};
+
+// for every vertex, the first vertex (lowest index) of its group of welded vertices
+static std::vector<index_t> weld_groups(const vertex_set_t& vs, const scalar_t eps, const unsigned threads)
+{
+	const index_t n = vs.size();
+	const cells grid(finite_range(vs), eps);
+
+	// (cell, vertex) of all finite vertices, sorted
+	std::vector<std::pair<uint64_t, index_t>> in_cell(n);
+	for_blocks(n, threads, [ &vs, &grid, &in_cell ] (const index_t i)
+	{
+		uint64_t xyz[3];
+		grid.at(vs[i], xyz);
+		in_cell[i] = std::make_pair(finite(vs[i]) ? cells::key(xyz[0], xyz[1], xyz[2]) : ~uint64_t(0), i);
+	});
+	parallel_sort(in_cell, threads, std::less<std::pair<uint64_t, index_t>>());
+	while(!in_cell.empty() && in_cell.back().first == ~uint64_t(0))
+	{
+		in_cell.pop_back();
+	}
+
+	// where every cell starts in in_cell
+	std::vector<index_t> starts;
+	for(index_t k = 0; k < in_cell.size(); k++)
+	{
+		if(k == 0 || in_cell[k].first != in_cell[k - 1].first)
+		{
+			starts.push_back(k);
+		}
+	}
+	starts.push_back(in_cell.size());
+	const index_t cell_count = starts.size() - 1;
+
+	// cell key -> cell (open addressing, linear probing)
+	int table_bits = 1;
+	for(; (size_t(1) << table_bits) < 2 * cell_count; table_bits++);
+	const uint64_t table_mask = (uint64_t(1) << table_bits) - 1;
+	const auto slot = [ table_bits ] (const uint64_t key)
+	{ return (key * 0x9e3779b97f4a7c15ull) >> (64 - table_bits); };
+	std::vector<std::pair<uint64_t, index_t>> table(table_mask + 1, std::make_pair(~uint64_t(0), index_t(0)));
+	for(index_t c = 0; c < cell_count; c++)
+	{
+		uint64_t s = slot(in_cell[starts[c]].first);
+		for(; table[s].first != ~uint64_t(0); s = (s + 1) & table_mask);
+		table[s] = std::make_pair(in_cell[starts[c]].first, c);
+	}
+
+	// every pair of close vertices in a cell, or in a cell and one of its
+	// neighbours (the one with the larger key), is united
+	concurrent_sets sets(n);
+	const scalar_t eps2 = eps * eps;
+	// eps in cells (and some more against rounding)
+	const coord_t margin = eps / grid.cell + 1e-6;
+	const auto close = [ &vs, eps2 ] (const index_t a, const index_t b)
+	{
+		const vertex_t d = vs[a].to(vs[b]);
+		return d.x() * d.x() + d.y() * d.y() + d.z() * d.z() <= eps2;
+	};
+	parallel_for((cell_count + 1023) / 1024, threads, [ & ] (const size_t b)
+	{
+		uint64_t probes = 0; // (slots of the table looked at)
+		for(index_t c = b * 1024; c < std::min<index_t>(cell_count, (b + 1) * 1024); c++)
+		{
+			const index_t cb = starts[c];
+			const index_t ce = starts[c + 1];
+			const uint64_t key = in_cell[cb].first;
+			for(index_t k = cb; k < ce; k++)
+			{
+				for(index_t l = k + 1; l < ce; l++)
+				{
+					if(close(in_cell[k].second, in_cell[l].second))
+					{
+						sets.unite(in_cell[k].second, in_cell[l].second);
+					}
+				}
+			}
+
+			// a neighbour only needs a look if a vertex of this cell is
+			// within eps of the side(s) it shares with it
+			uint64_t xyz[3];
+			grid.at(vs[in_cell[cb].second], xyz);
+			bool reach[3][3] = { { false, true, false }, { false, true, false }, { false, true, false } };
+			for(index_t k = cb; k < ce; k++)
+			{
+				const vertex_t& v = vs[in_cell[k].second];
+				const coord_t at[3] = { v.x(), v.y(), v.z() };
+				for(int a = 0; a < 3; a++)
+				{
+					const coord_t f = grid.offset(at[a], a, xyz[a]);
+					reach[a][0] = reach[a][0] || f <= margin;
+					reach[a][2] = reach[a][2] || f >= 1 - margin;
+				}
+			}
+			for(int dx = -1; dx <= 1; dx++)
+			for(int dy = -1; dy <= 1; dy++)
+			for(int dz = -1; dz <= 1; dz++)
+			{
+				if(!(reach[0][dx + 1] && reach[1][dy + 1] && reach[2][dz + 1]))
+				{
+					continue;
+				}
+				const uint64_t x = xyz[0] + dx, y = xyz[1] + dy, z = xyz[2] + dz;
+				const uint64_t top = (uint64_t(1) << weld_bits) - 1;
+				if(x > top || y > top || z > top)
+				{
+					continue; // (below 0 wraps around)
+				}
+				const uint64_t other = cells::key(x, y, z);
+				if(other <= key)
+				{
+					continue;
+				}
+				uint64_t s = slot(other);
+				for(probes++; table[s].first != other && table[s].first != ~uint64_t(0); s = (s + 1) & table_mask, probes++);
+				if(table[s].first != other)
+				{
+					continue;
+				}
+				for(index_t o = starts[table[s].second]; o < starts[table[s].second + 1]; o++)
+				{
+					for(index_t k = cb; k < ce; k++)
+					{
+						if(close(in_cell[k].second, in_cell[o].second))
+						{
+							sets.unite(in_cell[k].second, in_cell[o].second);
+						}
+					}
+				}
+			}
+		}
+		INSTRUMENT_COUNT(hash_probes, probes);
+	});
+
+	std::vector<index_t> group(n);
+	for_blocks(n, threads, [ &sets, &group ] (const index_t i)
+	{
+		group[i] = sets.find(i);
+	});
+	return group;
+}
+
+std::tuple<model_t, weld_report> weld(
+	const model_t& m,
+	const scalar_t eps,
+	const bool reorder,
+	const unsigned threads)
+{
+	INSTRUMENT_TIMER(weld);
+	const vertex_set_t& vs = m.vertex_set();
+	const index_t n = vs.size();
+	weld_report rep;
+	rep.vertices = n;
+	rep.faces = m.mesh().size();
+
+	// 1. welding
+	const std::vector<index_t> group = weld_groups(vs, std::max<scalar_t>(eps, 0), threads);
+	for(index_t i = 0; i < n; i++)
+	{
+		rep.welded += group[i] != i;
+	}
+
+	// 2. faces: degenerate ones are dropped, a duplicate is found next to
+	// its original when the faces are sorted on (rotated) vertices
+	std::vector<face_t> faces(m.mesh().size(), face_t(std::make_tuple(index_t(0), index_t(0), index_t(0))));
+	std::vector<char> keep(m.mesh().size());
+	for_blocks(faces.size(), threads, [ &m, &vs, &group, &faces, &keep ] (const index_t f)
+	{
+		const face_t& fc = m.mesh()[f];
+		const index_t a = group[fc.a()], b = group[fc.b()], c = group[fc.c()];
+		// (rotated so the lowest vertex comes first, the winding stays)
+		faces[f] = a < b && a < c ? face_t(std::make_tuple(a, b, c))
+			: b < c ? face_t(std::make_tuple(b, c, a))
+			: face_t(std::make_tuple(c, a, b));
+		keep[f] = a != b && b != c && a != c && triangle_surface(vs[a], vs[b], vs[c]) > 0;
+	});
+
+	std::vector<std::pair<face_t, index_t>> sorted;
+	sorted.reserve(faces.size());
+	for(index_t f = 0; f < faces.size(); f++)
+	{
+		if(keep[f])
+		{
+			sorted.push_back(std::make_pair(faces[f], f));
+		}
+		else
+		{
+			rep.degenerate++;
+		}
+	}
+	parallel_sort(sorted, threads, [] (const std::pair<face_t, index_t>& x, const std::pair<face_t, index_t>& y)
+	{
+		return x.first.pnts < y.first.pnts || (x.first.pnts == y.first.pnts && x.second < y.second);
+	});
+	for(index_t k = 1; k < sorted.size(); k++)
+	{
+		if(sorted[k].first.pnts == sorted[k - 1].first.pnts)
+		{
+			keep[sorted[k].second] = 0;
+			rep.duplicate++;
+		}
+	}
+	std::vector<std::pair<face_t, index_t>>().swap(sorted);
+
+	// 3. the vertices that are left, in their new order
+	std::vector<char> used(n, 0);
+	for(index_t f = 0; f < faces.size(); f++)
+	{
+		if(keep[f])
+		{
+			used[faces[f].a()] = used[faces[f].b()] = used[faces[f].c()] = 1;
+		}
+	}
+	std::vector<index_t> order;
+	for(index_t i = 0; i < n; i++)
+	{
+		if(used[i])
+		{
+			order.push_back(i);
+		}
+		else if(group[i] == i)
+		{
+			rep.unused++;
+		}
+	}
+	if(reorder)
+	{
+		const cells grid(finite_range(vs), 0);
+		std::vector<std::pair<uint64_t, index_t>> codes(order.size());
+		for_blocks(order.size(), threads, [ &vs, &grid, &order, &codes ] (const index_t k)
+		{
+			uint64_t xyz[3];
+			grid.at(vs[order[k]], xyz);
+			codes[k] = std::make_pair(spread(xyz[0]) << 2 | spread(xyz[1]) << 1 | spread(xyz[2]), order[k]);
+		});
+		parallel_sort(codes, threads, std::less<std::pair<uint64_t, index_t>>());
+		for(index_t k = 0; k < order.size(); k++)
+		{
+			order[k] = codes[k].second;
+		}
+	}
+
+	std::vector<index_t> remap(n, 0);
+	model_t res;
+	res.vertex_set().resize(order.size(), vertex_t(0));
+	for_blocks(order.size(), threads, [ &vs, &order, &remap, &res ] (const index_t k)
+	{
+		remap[order[k]] = k;
+		res.vertex_set()[k] = vs[order[k]];
+	});
+
+	// 4. the faces that are left, in the order of their lowest (new) vertex
+	std::vector<std::pair<index_t, index_t>> face_order;
+	for(index_t f = 0; f < faces.size(); f++)
+	{
+		if(keep[f])
+		{
+			const face_t& fc = m.mesh()[f];
+			face_order.push_back(std::make_pair(
+				reorder ? std::min( { remap[group[fc.a()]], remap[group[fc.b()]], remap[group[fc.c()]] } ) : 0,
+				f));
+		}
+	}
+	if(reorder)
+	{
+		parallel_sort(face_order, threads, std::less<std::pair<index_t, index_t>>());
+	}
+	res.mesh().resize(face_order.size(), face_t(std::make_tuple(index_t(0), index_t(0), index_t(0))));
+	for_blocks(face_order.size(), threads, [ &m, &group, &remap, &face_order, &res ] (const index_t k)
+	{
+		// (the original winding and first vertex)
+		const face_t& fc = m.mesh()[face_order[k].second];
+		res.mesh()[k] = face_t(std::make_tuple(
+			remap[group[fc.a()]],
+			remap[group[fc.b()]],
+			remap[group[fc.c()]]));
+	});
+
+	return std::make_tuple(std::move(res), rep);
+}
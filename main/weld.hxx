@@ -0,0 +1,44 @@
+#ifndef WELD_HEADER_FILE
+#define WELD_HEADER_FILE
+
+#include <iostream>
+#include <tuple>
+
+#include "types.hxx"
+#include "parallel.hxx"
+
+///////////////////////////////////////////
+//       vertex welding / compaction     //
+///////////////////////////////////////////
+
+// what weld() removed
+struct weld_report
+{
+	index_t vertices = 0;   // vertices before
+	index_t faces = 0;      // faces before
+	index_t welded = 0;     // vertices merged into another one
+	index_t unused = 0;     // vertices no face uses anymore
+	index_t degenerate = 0; // faces with a repeated vertex (after welding) or without area
+	index_t duplicate = 0;  // faces with the same vertices, in the same order, as an earlier face
+};
+
+std::ostream& operator<<(std::ostream& o, const weld_report& r);
+
+// a compacted copy of m:
+// 1. vertices closer than eps (or at the same place, for eps 0) are welded:
+//    they are looked up in a uniform grid of cells of (about) eps, in parallel.
+//    welding is transitive (a chain of close vertices becomes one), every
+//    group of vertices is replaced by the first of them (lowest index).
+// 2. faces that are degenerate, or the duplicate of an earlier face, are
+//    dropped, and then the vertices that are not used anymore.
+// 3. if reorder is set, the vertices are sorted in Morton (Z) order and the
+//    faces on their lowest vertex in that order, so faces that are close in
+//    space are close in memory (otherwise the original order is kept).
+// the result does not depend on the number of threads.
+std::tuple<model_t, weld_report> weld(
+	const model_t& m,
+	const scalar_t eps,
+	const bool reorder = true,
+	const unsigned threads = default_threads());
+
+#endif // WELD_HEADER_FILE
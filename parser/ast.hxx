@@ -0,0 +1,56 @@
+#ifndef AST_HEADER_FILE
+#define AST_HEADER_FILE
+
+#include <vector>
+
+///////////////////////////////////////////
+//       some config values              //
+///////////////////////////////////////////
+
+// const int vertex_dim = 3;
+//const int face_dim = 3;
+
+///////////////////////////////////////////
+//       (simple) AST definitions        //
+///////////////////////////////////////////
+
+template<typename T, int N>
+struct ast_param
+{
+	int n;
+	T num[N];
+
+	ast_param() : n(0), num() {}
+
+	ast_param(const T& c) : n(1), num()
+	{
+		num[0] = c;
+	}
+
+	void add(const T& c)
+	{
+		int i = n++;
+		if(i < N)
+		{
+			num[i] = c;
+		} 		
+	}
+};
+
+typedef ast_param<double, 4> ast_vert;
+typedef ast_param<int, 3> ast_face;
+
+struct ast_obj
+{
+	std::vector<ast_vert> verts;
+	std::vector<ast_face> faces;
+};
+
+// OBJ indices are 1-based, negative ones are relative to the last vertex
+// defined so far (-1 being that vertex). converts the latter to the former.
+inline int absolute_index(const ast_obj& dat, const int i)
+{
+	return i < 0 ? int(dat.verts.size()) + 1 + i : i;
+}
+
+#endif // AST_HEADER_FILE
@@ -0,0 +1,198 @@
+#ifndef BUILDER_HEADER_FILE
+#define BUILDER_HEADER_FILE
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../main/types.hxx"
+#include "../main/instrument.hxx"
+#include "ast.hxx"
+
+///////////////////////////////////////////
+//     single-pass model construction    //
+///////////////////////////////////////////
+
+// Scanner sink that builds the model directly, without an intermediate ast_obj.
+// Vertices are stored as they arrive, faces store absolute (0-based) vertex
+// indices. finish() then drops the invalid faces and the unused vertices and
+// renumbers the vertices in order of first use (exactly as build_model does),
+// using a flat remap array and an in-place permutation. Peak memory is the final
+// model + one index per vertex.
+class model_builder
+{
+public:
+	static constexpr index_t invalid = std::numeric_limits<index_t>::max();
+
+	// a face with an index that can't be verified (yet) when it is read:
+	// a forward reference or an index out of bounds
+	struct suspect
+	{
+		index_t pos; // position in the mesh
+		int f_i;     // number of the face in the file (1-based)
+		ast_face face;
+	};
+
+private:
+	model_t mod;
+	std::vector<suspect> suspects;
+	int f_i = 0;
+	bool faces_dropped = false;
+	std::ostream* log = &std::cerr; // where the warnings go
+
+public:
+	model_builder() {}
+	model_builder(std::ostream& l) : log(&l) {}
+
+	// resumes from a state that was assembled elsewhere (see parse_chunked):
+	// the faces hold absolute indices, every face with an index that is not
+	// below the number of vertices must be in suspects (ordered by position)
+	model_builder(
+		model_t&& m,
+		std::vector<suspect>&& s,
+		const int faces_read,
+		const bool dropped,
+		std::ostream& l = std::cerr)
+	: mod(std::move(m)), suspects(std::move(s)), f_i(faces_read), faces_dropped(dropped), log(&l) {}
+
+	void vertex(const ast_vert& v)
+	{
+		mod.vertex_set().push_back( { { v.num[0], v.num[1], v.num[2] } } );
+	}
+
+	void face(const ast_face& fc)
+	{
+		f_i++;
+		if(fc.n != 3)
+		{
+			// too many or too few vertices in current face (ignore this face)
+			*log << "**Warning: too many or too few vertices in face " << f_i << " (ignoring this face)\n";
+			faces_dropped = true;
+			return;
+		}
+
+		index_t idx[3];
+		if(!resolve(fc, mod.vertex_set().size(), idx))
+		{
+			suspects.push_back( { mod.mesh().size(), f_i, fc } );
+		}
+		mod.mesh().push_back( { { idx[0], idx[1], idx[2] } } );
+	}
+
+	// absolute, 0-based indices of a triangle, read after 'count' vertices
+	// (relative indices point back from the last of those).
+	// returns whether all indices point to one of those vertices.
+	static bool resolve(const ast_face& fc, const index_t count, index_t idx[3])
+	{
+		bool ok = true;
+		for(int i = 0; i < 3; i++)
+		{
+			const int64_t n = fc.num[i];
+			idx[i] =
+				n > 0 ? index_t(n - 1)
+				: (n < 0 && index_t(-n) <= count) ? count - index_t(-n)
+				: invalid;
+			ok = ok && idx[i] < count;
+		}
+		return ok;
+	}
+
+	// see parse() for the meaning of the returned tuple
+	std::tuple<model_t, bool, bool> finish()
+	{
+		INSTRUMENT_TIMER(remap);
+		const index_t total = mod.vertex_set().size();
+
+		// 1. map every vertex index in order of first use, dropping bad faces
+		std::vector<index_t> remap(total, invalid);
+		index_t used = 0;
+		index_t out = 0;
+		std::vector<suspect>::const_iterator sus = suspects.begin();
+		for(index_t pos = 0; pos < mod.mesh().size(); pos++)
+		{
+			face_t fc = mod.mesh()[pos];
+			const suspect* s = nullptr;
+			if(sus != suspects.end() && sus -> pos == pos)
+			{
+				s = &*(sus++);
+			}
+
+			index_t* idx[3] = { &fc.a(), &fc.b(), &fc.c() };
+			int i = 0;
+			for(; i < 3; i++)
+			{
+				if(*idx[i] >= total)
+				{
+					// index out of bounds (ignore this face)
+					// only suspects can get here
+					*log
+						<< "**Warning: index "
+						<< s -> face.num[i]
+						<< " not pointing to valid vertex for face "
+						<< s -> f_i << "\n";
+					break;
+				}
+				if(remap[*idx[i]] == invalid)
+				{
+					remap[*idx[i]] = used++;
+				}
+				*idx[i] = remap[*idx[i]];
+			}
+
+			if(i != 3)
+			{
+				// some vertice indices are wrong (ignore this face)
+				*log
+					<< "**Warning: ignoring face "
+					<< s -> f_i
+					<< " due to aformentioned error(s)\n";
+				faces_dropped = true;
+				continue;
+			}
+			mod.mesh()[out++] = fc;
+		}
+		mod.mesh().erase(mod.mesh().begin() + out, mod.mesh().end());
+
+		// 2. unused vertices go to the back...
+		index_t next = used;
+		for(index_t& r: remap)
+		{
+			if(r == invalid)
+			{
+				r = next++;
+			}
+		}
+
+		// 3. ...so after moving every vertex to its new place, they can be cut off
+		for(index_t i = 0; i < total; i++)
+		{
+			while(remap[i] != i)
+			{
+				std::swap(mod.vertex_set()[i], mod.vertex_set()[remap[i]]);
+				std::swap(remap[i], remap[remap[i]]);
+			}
+		}
+		mod.vertex_set().erase(mod.vertex_set().begin() + used, mod.vertex_set().end());
+
+		// request to save up some space
+		mod.vertex_set().shrink_to_fit();
+		mod.mesh().shrink_to_fit();
+
+		INSTRUMENT_COUNT(vertices_read, total);
+		INSTRUMENT_COUNT(vertices_unused, total - used);
+		INSTRUMENT_COUNT(faces_read, f_i);
+		INSTRUMENT_COUNT(faces_accepted, out);
+		INSTRUMENT_COUNT(faces_dropped, f_i - out);
+
+		bool semantics_ok = !faces_dropped && used == total;
+		return std::tuple<model_t, bool, bool>(
+			std::move(mod),
+			true, // syntax ok
+			semantics_ok);
+	}
+};
+
+#endif // BUILDER_HEADER_FILE
@@ -0,0 +1,187 @@
+#ifndef CHUNKED_HEADER_FILE
+#define CHUNKED_HEADER_FILE
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../main/types.hxx"
+#include "../main/parallel.hxx"
+#include "../main/instrument.hxx"
+#include "ast.hxx"
+#include "scanner.hxx"
+#include "builder.hxx"
+
+///////////////////////////////////////////
+//     multi-threaded (chunked) parsing  //
+///////////////////////////////////////////
+
+// The input is cut into chunks at line boundaries, every chunk is scanned
+// on its own (into an obj_chunk). Once the number of vertices and faces of
+// every chunk is known, the chunks are merged (in parallel as well) into one
+// model, and model_builder does the rest. The result is identical to the one
+// of the single-pass parser, whatever the number of threads or chunks.
+
+// the records of one chunk
+struct obj_chunk
+{
+	// a face with relative (or zero) indices: these can only be resolved
+	// once the number of vertices before this chunk is known
+	struct relative
+	{
+		index_t pos;   // position in faces
+		index_t count; // vertices in this chunk before the face
+		ast_face face;
+	};
+
+	std::vector<vertex_t> verts;
+	std::vector<face_t> faces; // absolute indices, except for the relative ones
+	std::vector<relative> relatives;
+	std::vector<int> wrong_size; // numbers (within the chunk) of the faces that aren't triangles
+	int faces_read = 0;
+	bool syntax = true;
+
+	void vertex(const ast_vert& v)
+	{
+		verts.push_back( { { v.num[0], v.num[1], v.num[2] } } );
+	}
+
+	void face(const ast_face& fc)
+	{
+		faces_read++;
+		if(fc.n != 3)
+		{
+			wrong_size.push_back(faces_read);
+			return;
+		}
+		if(fc.num[0] <= 0 || fc.num[1] <= 0 || fc.num[2] <= 0)
+		{
+			relatives.push_back( { faces.size(), verts.size(), fc } );
+		}
+		faces.push_back( { {
+			index_t(fc.num[0] - 1),
+			index_t(fc.num[1] - 1),
+			index_t(fc.num[2] - 1)
+		} } );
+	}
+};
+
+// see parse() for the meaning of the returned tuple (warnings go to log)
+inline std::tuple<model_t, bool, bool> parse_chunked(
+	const char* f,
+	const char* l,
+	const unsigned threads,
+	const size_t min_chunk = size_t(1) << 20,
+	std::ostream& log = std::cerr)
+{
+	// more chunks than threads, to even out the load. chunks should not
+	// get too small either (the number of chunks doesn't change the result)
+	const size_t n = std::max<size_t>(1,
+		std::min<size_t>(size_t(threads) * 4, (l - f) / std::max<size_t>(min_chunk, 1)));
+
+	std::vector<const char*> bounds(n + 1, l);
+	bounds[0] = f;
+	for(size_t i = 1; i < n; i++)
+	{
+		bounds[i] = scanner::next_line(
+			std::max(bounds[i - 1], f + (l - f) / n * i), l);
+	}
+
+	std::vector<obj_chunk> chunks(n);
+	{
+		INSTRUMENT_TIMER(parse);
+		parallel_for(n, threads, [ &chunks, &bounds ] (const size_t i)
+		{
+			chunks[i].syntax = scanner::scan(bounds[i], bounds[i + 1], chunks[i]);
+		});
+	}
+
+	// where every chunk starts in the end result
+	std::vector<index_t> vert_off(n + 1, 0);
+	std::vector<index_t> face_off(n + 1, 0);
+	std::vector<int> read_off(n + 1, 0);
+	bool dropped = false;
+	for(size_t i = 0; i < n; i++)
+	{
+		if(!chunks[i].syntax)
+		{
+			return std::tuple<model_t, bool, bool>(model_t(), false, false);
+		}
+		vert_off[i + 1] = vert_off[i] + chunks[i].verts.size();
+		face_off[i + 1] = face_off[i] + chunks[i].faces.size();
+		read_off[i + 1] = read_off[i] + chunks[i].faces_read;
+		for(int w: chunks[i].wrong_size)
+		{
+			log << "**Warning: too many or too few vertices in face " << (read_off[i] + w) << " (ignoring this face)\n";
+			dropped = true;
+		}
+	}
+
+	const index_t total = vert_off[n];
+	model_t mod;
+	mod.vertex_set().resize(total, vertex_t(0));
+	mod.mesh().resize(face_off[n], face_t(std::make_tuple(index_t(0), index_t(0), index_t(0))));
+
+	std::vector<std::vector<model_builder::suspect>> suspects(n);
+	parallel_for(n, threads, [ & ] (const size_t c)
+	{
+		obj_chunk& ch = chunks[c];
+		std::copy(ch.verts.begin(), ch.verts.end(), mod.vertex_set().begin() + vert_off[c]);
+		std::vector<vertex_t>().swap(ch.verts);
+
+		std::vector<obj_chunk::relative>::const_iterator rel = ch.relatives.begin();
+		size_t wrong = 0;
+		for(index_t pos = 0; pos < ch.faces.size(); pos++)
+		{
+			index_t idx[3];
+			ast_face fc;
+			if(rel != ch.relatives.end() && rel -> pos == pos)
+			{
+				model_builder::resolve(rel -> face, vert_off[c] + rel -> count, idx);
+				fc = (rel++) -> face;
+			}
+			else
+			{
+				idx[0] = ch.faces[pos].a();
+				idx[1] = ch.faces[pos].b();
+				idx[2] = ch.faces[pos].c();
+			}
+			mod.mesh()[face_off[c] + pos] = face_t(std::make_tuple(idx[0], idx[1], idx[2]));
+
+			if(idx[0] < total && idx[1] < total && idx[2] < total)
+			{
+				continue;
+			}
+
+			// will be dropped by model_builder, which needs the number of
+			// the face in the file (counting the faces that were not triangles)
+			// and the original record
+			for(; wrong < ch.wrong_size.size()
+				&& ch.wrong_size[wrong] <= int(pos + 1 + wrong); wrong++);
+			if(fc.n == 0)
+			{
+				fc = ast_face(int(idx[0] + 1));
+				fc.add(int(idx[1] + 1));
+				fc.add(int(idx[2] + 1));
+			}
+			suspects[c].push_back( {
+				face_off[c] + pos,
+				read_off[c] + int(pos + 1 + wrong),
+				fc } );
+		}
+		std::vector<face_t>().swap(ch.faces);
+	});
+
+	std::vector<model_builder::suspect> all;
+	for(const std::vector<model_builder::suspect>& s: suspects)
+	{
+		all.insert(all.end(), s.begin(), s.end());
+	}
+
+	model_builder builder(std::move(mod), std::move(all), read_off[n], dropped, log);
+	return builder.finish();
+}
+
+#endif // CHUNKED_HEADER_FILE
@@ -0,0 +1,55 @@
+#ifndef MAPPED_FILE_HEADER_FILE
+#define MAPPED_FILE_HEADER_FILE
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/filesystem.hpp>
+
+#include <string>
+
+namespace interprocess = boost::interprocess;
+
+// read-only memory-mapping of a complete file.
+// the bytes are available through [begin(), end()) as long as
+// this object lives, no copies are made.
+class mapped_file final
+{
+private:
+	interprocess::file_mapping mapping;
+	interprocess::mapped_region region;
+	bool open;
+
+public:
+	mapped_file(const std::string& path) : open(false)
+	{
+		try
+		{
+			// mapping an empty file is not allowed, but it is
+			// still a valid (empty) file
+			if(boost::filesystem::file_size(path) == 0)
+			{
+				open = true;
+				return;
+			}
+			mapping = interprocess::file_mapping(path.c_str(), interprocess::read_only);
+			region = interprocess::mapped_region(mapping, interprocess::read_only);
+			// we will (almost) always read the file front to back
+			region.advise(interprocess::mapped_region::advice_sequential);
+			open = true;
+		}
+		catch(const interprocess::interprocess_exception&) {}
+		catch(const boost::filesystem::filesystem_error&) {}
+	}
+
+	mapped_file(const mapped_file&) = delete;
+	const mapped_file& operator=(const mapped_file&) = delete;
+
+	const bool is_open() const { return open; }
+
+	const char* begin() const { return static_cast<const char*>(region.get_address()); }
+	const char* end() const { return begin() + size(); }
+	const size_t size() const { return region.get_size(); }
+};
+
+#endif // MAPPED_FILE_HEADER_FILE
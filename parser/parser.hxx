@@ -22,6 +22,12 @@
 #include <tuple>
 
 #include "../main/types.hxx"
+#include "../main/instrument.hxx"
+#include "ast.hxx"
+#include "scanner.hxx"
+#include "builder.hxx"
+#include "chunked.hxx"
+#include "mapped_file.hxx"
 
 namespace spirit = boost::spirit;
 namespace fusion = boost::fusion;
@@ -29,47 +35,6 @@ namespace phoenix = boost::phoenix;
 namespace qi = boost::spirit::qi;
 namespace encoding = qi::ascii;
 
-///////////////////////////////////////////
-//       some config values              //
-///////////////////////////////////////////
-
-// const int vertex_dim = 3;
-//const int face_dim = 3;
-
-///////////////////////////////////////////
-//       (simple) AST definitions        //
-///////////////////////////////////////////
-
-template<typename T, int N>
-struct ast_param
-{
-	int n;
-	T num[N];
-
-	ast_param(const T& c) : n(1)
-	{
-		num[0] = c;
-	}
-
-	void add(const T& c)
-	{
-		int i = n++;
-		if(i < N)
-		{
-			num[i] = c;
-		} 		
-	}
-};
-
-typedef ast_param<double, 4> ast_vert;
-typedef ast_param<int, 3> ast_face;
-
-struct ast_obj
-{
-	std::vector<ast_vert> verts;
-	std::vector<ast_face> faces;
-};
-
 ///////////////////////////////////////////
 //         parser definitions            //
 ///////////////////////////////////////////
@@ -147,14 +112,14 @@ public:
 									// here to initialize a new face record
 									// in the AST...
 									[] (ast_obj& dat, const int p) {
-										dat.faces.push_back(ast_face(p));
+										dat.faces.push_back(ast_face(absolute_index(dat, p)));
 									}, _val, _1
 								) ]					
 				>> *( +encoding::blank
 					>> face_param		[ phoenix::bind(
 									// ... and here to update the face record
 									[] (ast_obj& dat, const int p) {
-										dat.faces.back().add(p);
+										dat.faces.back().add(absolute_index(dat, p));
 									}, _val, _1
 								) ]
 				)
@@ -179,21 +144,21 @@ public:
 // 	bool   -> whether semantics      //
 // 	          were ok                //
 ///////////////////////////////////////////
+inline std::tuple<model_t, bool, bool> build_model(const ast_obj& result, std::ostream& log = std::cerr);
+
 template<typename It>
 std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets updated
 {
 	static const skipper<It> s = {};
 	static const obj_parser<It, skipper<It> > p;
 
-	// the actual data used to create the returned end-result.
-	model_t mod;
-
 	ast_obj result;
 	try
 	{
+		INSTRUMENT_TIMER(parse);
 		if(!(qi::phrase_parse(f, l, p, s, result) && f == l))
 		{
-			return std::tuple<model_t, bool, bool>(mod, false, false);
+			return std::tuple<model_t, bool, bool>(model_t(), false, false);
 		}
 	}
 	catch(const qi::expectation_failure<It>& e)
@@ -201,10 +166,21 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 		std::cerr << e.what() << "'\n";
 		return std::move(
 			std::tuple<model_t, bool, bool>(
-				std::move(mod), false, false));
+				model_t(), false, false));
 	}
 
 	// syntax OK, semantics now
+	return build_model(result);
+}
+
+// semantic stage: turns a (syntactically correct) AST into a model
+// (warnings go to log)
+inline std::tuple<model_t, bool, bool> build_model(const ast_obj& result, std::ostream& log)
+{
+	INSTRUMENT_TIMER(remap);
+	// the actual data used to create the returned end-result.
+	model_t mod;
+
 	// first: attempt some preformance increase by preliminary allocating enough space
 	mod.vertex_set().reserve(result.verts.size());
 	mod.mesh().reserve(result.faces.size());
@@ -213,6 +189,7 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 	std::unordered_map<int, index_t> vert_idx_mapping;
 
 	int f_i = 1;
+	uint64_t probes = 0; // (lookups in vert_idx_mapping)
 	index_t new_face[3]; // for re-use
 	for(std::vector<ast_face>::const_iterator it = result.faces.begin();
 		it != result.faces.end();
@@ -221,7 +198,7 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 		if((it -> n) != 3)
 		{
 			// too many or too few vertices in current face (ignore this face)
-			std::cerr << "**Warning: too many or too few vertices in face " << f_i << " (ignoring this face)\n";
+			log << "**Warning: too many or too few vertices in face " << f_i << " (ignoring this face)\n";
 			continue;
 		}
 
@@ -229,24 +206,22 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 		for(; i < 3; i++)
 		{
 
-			if(abs(it -> num[i]) > result.verts.size())
+			if(it -> num[i] < 1 || it -> num[i] > int(result.verts.size()))
 			{
 				// index out of bounds (ignore this face)
-				std::cerr
+				log
 					<< "**Warning: index "
 					<< it -> num[i]
 					<< " not pointing to valid vertex for face "
 					<< f_i << "\n";
 				break;
 			}
-			// calculate the absolute index (in the obj file, indexes are circular and 1-based)
-			int idx = 
-				it -> num[i] < 0
-				? (result.faces.size() - (it -> num[i]))
-				: (it -> num[i] - 1);
+			// in the obj file indexes are 1-based (relative ones are already resolved)
+			int idx = it -> num[i] - 1;
 
 			// is the vertex already encountered?
 			std::unordered_map<int, index_t>::iterator present_one = vert_idx_mapping.find(idx);
+			probes++;
 			if(present_one == vert_idx_mapping.end())
 			{
 				// nope, not encountered. Add vertice to local storage, and use that index.
@@ -263,8 +238,8 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 				if(!ins_or_not.second)
 				{
 					// something went wrong with the insertion which was not supposed to happen. PANIC!
-					std::cerr << "**Error: internal error when evaluating face " << f_i << "\n";
-					std::cerr << "Aborting parsing process\n";
+					log << "**Error: internal error when evaluating face " << f_i << "\n";
+					log << "Aborting parsing process\n";
 					return std::move(
 						std::tuple<model_t, bool, bool>(
 							std::move(mod), false, false));
@@ -280,7 +255,7 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 		if(i != 3)
 		{
 			// some vertice indices are wrong (ignore this face)
-			std::cerr
+			log
 				<< "**Warning: ignoring face "
 				<< f_i
 				<< " due to aformentioned error(s)\n";
@@ -302,6 +277,13 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 	mod.vertex_set().shrink_to_fit();
 	mod.mesh().shrink_to_fit();
 
+	INSTRUMENT_COUNT(vertices_read, result.verts.size());
+	INSTRUMENT_COUNT(vertices_unused, result.verts.size() - mod.vertex_set().size());
+	INSTRUMENT_COUNT(faces_read, result.faces.size());
+	INSTRUMENT_COUNT(faces_accepted, mod.mesh().size());
+	INSTRUMENT_COUNT(faces_dropped, result.faces.size() - mod.mesh().size());
+	INSTRUMENT_COUNT(hash_probes, probes);
+
 	bool semantics_ok =
 		mod.mesh().size() == result.faces.size()
 		&& mod.vertex_set().size() == result.verts.size();
@@ -313,7 +295,7 @@ std::tuple<model_t, bool, bool> parse(It& f, It l) // note: first iterator gets
 			semantics_ok)); 
 }
 
-std::tuple<model_t, bool, bool> parse(std::istream& is)
+inline std::tuple<model_t, bool, bool> parse(std::istream& is)
 {
 	is.unsetf(std::ios::skipws);
 	spirit::istream_iterator start(is);
@@ -322,4 +304,94 @@ std::tuple<model_t, bool, bool> parse(std::istream& is)
 	return parse(start, end);
 }
 
+// how the scanner path turns the records into a model
+enum class parse_mode
+{
+	ast,        // via an intermediate ast_obj and build_model (as parse(It&, It) does)
+	single_pass // straight into the model (see model_builder), less memory and faster
+};
+
+// fast path: scans the raw bytes of a (memory-mapped) file
+// in single-pass mode, more than one thread can be used (see parse_chunked).
+// warnings go to log.
+inline std::tuple<model_t, bool, bool> parse(
+	const char* f,
+	const char* l,
+	const parse_mode mode = parse_mode::single_pass,
+	const unsigned threads = 1,
+	std::ostream& log = std::cerr)
+{
+	INSTRUMENT_COUNT(bytes_read, l - f);
+	if(mode == parse_mode::single_pass && threads > 1)
+	{
+		return parse_chunked(f, l, threads, size_t(1) << 20, log);
+	}
+	if(mode == parse_mode::single_pass)
+	{
+		model_builder builder(log);
+		bool syntax;
+		{
+			INSTRUMENT_TIMER(parse);
+			syntax = scanner::scan(f, l, builder);
+		}
+		if(!syntax)
+		{
+			return std::tuple<model_t, bool, bool>(model_t(), false, false);
+		}
+		return builder.finish();
+	}
+
+	// collects the records as obj_parser would
+	struct ast_sink
+	{
+		ast_obj& dat;
+		void vertex(const ast_vert& v) { dat.verts.push_back(v); }
+		void face(const ast_face& f)
+		{
+			dat.faces.push_back(f);
+			for(int& i: dat.faces.back().num)
+			{
+				i = absolute_index(dat, i);
+			}
+		}
+	};
+
+	ast_obj result;
+	ast_sink sink = { result };
+	bool syntax;
+	{
+		INSTRUMENT_TIMER(parse);
+		syntax = scanner::scan(f, l, sink);
+	}
+	if(!syntax)
+	{
+		return std::tuple<model_t, bool, bool>(model_t(), false, false);
+	}
+
+	return build_model(result, log);
+}
+
+inline std::tuple<model_t, bool, bool> parse(
+	const mapped_file& file,
+	const parse_mode mode = parse_mode::single_pass,
+	const unsigned threads = 1,
+	std::ostream& log = std::cerr)
+{
+	return parse(file.begin(), file.end(), mode, threads, log);
+}
+
+inline std::tuple<model_t, bool, bool> parse_file(
+	const std::string& path,
+	const parse_mode mode = parse_mode::single_pass,
+	const unsigned threads = 1)
+{
+	mapped_file file(path);
+	if(!file.is_open())
+	{
+		std::cerr << "**Error: can't map '" << path << "'\n";
+		return std::tuple<model_t, bool, bool>(model_t(), false, false);
+	}
+	return parse(file, mode, threads);
+}
+
 #endif // PARSER_HEADER_FILE
@@ -0,0 +1,360 @@
+#ifndef SCANNER_HEADER_FILE
+#define SCANNER_HEADER_FILE
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <vector>
+
+#include "../main/instrument.hxx"
+#include "ast.hxx"
+
+///////////////////////////////////////////
+//     hand-written OBJ scanner          //
+///////////////////////////////////////////
+
+// A scanner for the same (subset of the) OBJ format as obj_parser,
+// working on a contiguous range of raw bytes (e.g. a memory-mapped file)
+// instead of a (character-by-character) iterator.
+// Differences with obj_parser: 'v' and 'f' are only recognized as
+// keywords at the start of a line (as the OBJ format prescribes).
+//
+// Every vertex and face record is handed to a 'sink', which must provide:
+// 	void vertex(const ast_vert&);
+// 	void face(const ast_face&);
+
+namespace scanner
+{
+
+inline const bool is_blank(const char c)
+{ return c == ' ' || c == '\t'; }
+
+inline const bool is_eol(const char c)
+{ return c == '\n' || c == '\r'; }
+
+inline const bool is_digit(const char c)
+{ return static_cast<unsigned char>(c - '0') < 10; }
+
+inline const bool is_ascii(const char c)
+{ return static_cast<unsigned char>(c) < 0x80; }
+
+// parses an integer (as qi::int_ does: optional sign, at least one digit, no overflow)
+// returns the position after the integer, or f on failure
+inline const char* parse_int(const char* f, const char* l, int& out)
+{
+	const char* p = f;
+	bool neg = false;
+	if(p != l && (*p == '-' || *p == '+'))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	if(p == l || !is_digit(*p))
+	{
+		return f;
+	}
+
+	int64_t v = 0;
+	const int64_t lim = int64_t(std::numeric_limits<int>::max()) + (neg ? 1 : 0);
+	for(; p != l && is_digit(*p); p++)
+	{
+		v = v * 10 + (*p - '0');
+		if(v > lim)
+		{
+			return f; // overflow
+		}
+	}
+	out = static_cast<int>(neg ? -v : v);
+	return p;
+}
+
+// parses a real number (as qi::double_ does: optional sign, digits with optional
+// leading or trailing dot, optional exponent, or inf/nan)
+// returns the position after the number, or f on failure
+inline const char* parse_double(const char* f, const char* l, double& out)
+{
+	// exact powers of ten (all representable as a double)
+	static const double pow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* p = f;
+	bool neg = false;
+	if(p != l && (*p == '-' || *p == '+'))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	const char* num = p; // start of unsigned part
+
+	uint64_t mant = 0;
+	int sig = 0; // significant digits in mant
+	int exp10 = 0;
+	bool any = false;
+
+	for(; p != l && is_digit(*p); p++, any = true)
+	{
+		if(sig < 19)
+		{
+			mant = mant * 10 + (*p - '0');
+			sig += (mant != 0);
+		}
+		else
+		{
+			sig++; // too many digits for the fast path
+		}
+	}
+	if(p != l && *p == '.')
+	{
+		p++;
+		for(; p != l && is_digit(*p); p++, any = true)
+		{
+			if(sig < 19)
+			{
+				mant = mant * 10 + (*p - '0');
+				sig += (mant != 0);
+				exp10--;
+			}
+			else
+			{
+				sig++;
+			}
+		}
+	}
+
+	if(!any)
+	{
+		// no digits, maybe one of the special values
+		auto match = [ l ] (const char* s, const char* word) -> const char*
+		{
+			for(; *word; s++, word++)
+			{
+				if(s == l || (*s | 0x20) != *word)
+				{
+					return nullptr;
+				}
+			}
+			return s;
+		};
+		const char* e;
+		if((e = match(num, "infinity")) || (e = match(num, "inf")))
+		{
+			out = neg
+				? -std::numeric_limits<double>::infinity()
+				: std::numeric_limits<double>::infinity();
+			return e;
+		}
+		if((e = match(num, "nan")))
+		{
+			out = std::numeric_limits<double>::quiet_NaN();
+			return e;
+		}
+		return f;
+	}
+
+	// optional exponent, only consumed when complete
+	if(p != l && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool eneg = false;
+		if(e != l && (*e == '-' || *e == '+'))
+		{
+			eneg = (*e == '-');
+			e++;
+		}
+		if(e != l && is_digit(*e))
+		{
+			int ev = 0;
+			for(; e != l && is_digit(*e); e++)
+			{
+				ev = std::min(ev * 10 + (*e - '0'), 100000);
+			}
+			exp10 += eneg ? -ev : ev;
+			p = e;
+		}
+	}
+
+	// fast path (Clinger): both mantissa and power of ten are exact doubles,
+	// so a single multiplication/division is correctly rounded
+	if(sig <= 19 && mant <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22)
+	{
+		double v = static_cast<double>(mant);
+		v = exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+		out = neg ? -v : v;
+		return p;
+	}
+
+	// slow path: let the standard library do the (correctly rounded) conversion
+	double v;
+	std::from_chars_result r = std::from_chars(num, p, v, std::chars_format::general);
+	if(r.ec == std::errc::result_out_of_range)
+	{
+		// (roughly) the decimal magnitude decides between overflow and underflow
+		v = (exp10 + sig > 0) ? std::numeric_limits<double>::infinity() : 0;
+	}
+	out = neg ? -v : v;
+	return p;
+}
+
+// one 'v' record; p points after the 'v' (at a blank)
+template<typename Sink>
+const char* scan_vertex(const char* p, const char* l, Sink& sink)
+{
+	ast_vert v;
+	while(p != l && is_blank(*p))
+	{
+		while(p != l && is_blank(*p))
+		{
+			p++;
+		}
+		double d;
+		const char* e = parse_double(p, l, d);
+		if(e == p)
+		{
+			break;
+		}
+		v.add(d);
+		p = e;
+	}
+	if(v.n > 0)
+	{
+		sink.vertex(v);
+	}
+	return p;
+}
+
+// one 'f' record; p points after the 'f' (at a blank)
+// only the vertex index of each 'v/vt/vn' parameter is kept
+template<typename Sink>
+const char* scan_face(const char* p, const char* l, Sink& sink)
+{
+	ast_face fc;
+	while(p != l && is_blank(*p))
+	{
+		while(p != l && is_blank(*p))
+		{
+			p++;
+		}
+		int i;
+		const char* e = parse_int(p, l, i);
+		if(e == p)
+		{
+			break;
+		}
+		p = e;
+		if(p != l && *p == '/')
+		{
+			int ignore;
+			p = parse_int(++p, l, ignore);
+			if(p != l && *p == '/')
+			{
+				p = parse_int(++p, l, ignore);
+			}
+		}
+		fc.add(i);
+	}
+	if(fc.n > 0)
+	{
+		sink.face(fc);
+	}
+	return p;
+}
+
+// scans [f, l) line by line
+// returns false on a syntax error (bytes that are not ascii)
+template<typename Sink>
+bool scan(const char* f, const char* l, Sink& sink)
+{
+	const char* p = f;
+	while(p != l)
+	{
+		while(p != l && is_blank(*p))
+		{
+			p++;
+		}
+		if(p + 1 < l && is_blank(p[1]))
+		{
+			if(*p == 'v')
+			{
+				p = scan_vertex(p + 1, l, sink);
+			}
+			else if(*p == 'f')
+			{
+				p = scan_face(p + 1, l, sink);
+			}
+		}
+
+		// ignore the rest of the line (comment, unsupported statement, ...)
+		unsigned char seen = 0;
+		for(; p != l && !is_eol(*p); p++)
+		{
+			seen |= static_cast<unsigned char>(*p);
+		}
+		if(!is_ascii(seen))
+		{
+			return false;
+		}
+		for(; p != l && is_eol(*p); p++);
+	}
+	return true;
+}
+
+// the start of the first line after the one p is in (or l)
+inline const char* next_line(const char* p, const char* l)
+{
+	for(; p != l && !is_eol(*p); p++);
+	for(; p != l && is_eol(*p); p++);
+	return p;
+}
+
+// scans what is read from in, buffer_size bytes at a time: only complete lines
+// are scanned, the rest is kept for the next read (the buffer grows when a
+// single line does not fit). the sink sees the same records as with scan().
+// returns false on a syntax error or when in can't be read.
+template<typename Sink>
+bool scan(std::istream& in, const size_t buffer_size, Sink& sink)
+{
+	std::vector<char> buf(std::max<size_t>(buffer_size, 2));
+	size_t have = 0;
+	bool eof = false;
+	while(!eof)
+	{
+		in.read(buf.data() + have, buf.size() - have);
+		if(in.bad())
+		{
+			return false;
+		}
+		have += size_t(in.gcount());
+		INSTRUMENT_COUNT(bytes_read, in.gcount());
+		eof = have < buf.size();
+
+		const char* f = buf.data();
+		const char* l = f + have;
+		const char* cut = l;
+		if(!eof)
+		{
+			for(; cut != f && !is_eol(cut[-1]); cut--);
+			if(cut == f)
+			{
+				buf.resize(buf.size() * 2);
+				continue;
+			}
+		}
+		if(!scan(f, cut, sink))
+		{
+			return false;
+		}
+		have = l - cut;
+		std::memmove(buf.data(), cut, have);
+	}
+	return true;
+}
+
+} // namespace scanner
+
+#endif // SCANNER_HEADER_FILE
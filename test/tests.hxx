@@ -13,6 +13,8 @@
 #include <boost/test/data/monomorphic.hpp>
 
 #include "../parser/parser.hxx"
+#include "../main/cache.hxx"
+#include "../main/stream.hxx"
 
 namespace udata = boost::unit_test::data;
 
@@ -33,6 +35,12 @@ BOOST_AUTO_TEST_SUITE(parser)
 		return std::get<1>(res) && (std::get<2>(res) || !semantics_check);
 	}
 
+	bool scanString(const std::string& input, bool semantics_check)
+	{
+		auto res = parse(input.data(), input.data() + input.size());
+		return std::get<1>(res) && (std::get<2>(res) || !semantics_check);
+	}
+
 	BOOST_AUTO_TEST_CASE(parse_line)
 	{
 		// check simple syntax
@@ -52,6 +60,103 @@ BOOST_AUTO_TEST_SUITE(parser)
 
 	}
 
+	BOOST_AUTO_TEST_CASE(scan_line)
+	{
+		// same checks as parse_line, for the scanner
+		BOOST_TEST(scanString("", false));
+		BOOST_TEST(scanString("\n\n\n", false));
+		BOOST_TEST(scanString("# only comment", false));
+		BOOST_TEST(scanString("# one comment\n    # two comment", false));
+
+		BOOST_TEST(scanString("v 1.5 3 2 5.6", false));
+		BOOST_TEST(scanString("v 1.5 5.6 3      ", false));
+		BOOST_TEST(scanString("v 1.5    5.6 3   \n v 3 4 5", false));
+
+		BOOST_TEST(scanString("# start comment\nv 1 2 3", false));
+		BOOST_TEST(scanString("v 1 2 3\n#end comment", false));
+		BOOST_TEST(scanString("#first enclosing comment\nv 1 2 3\n#second enclosing comment", false));
+		BOOST_TEST(scanString("v 1 2 3 # partial comment\nv 4 5 6", false));
+
+		BOOST_TEST(scanString("v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nf 1 2 3\r\n", true));
+		BOOST_TEST(scanString("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/1/1 2//2 3/3\n", true));
+
+		// not ascii
+		BOOST_TEST(!scanString("v 1 2 3\n# caf\xc3\xa9\n", false));
+	}
+
+	BOOST_AUTO_TEST_CASE(scan_numbers)
+	{
+		const std::string input =
+			"v 1.5 -2 +3e2\n"
+			"v .25 4. -1.5E-3\n"
+			"v 0.1 12345678901234567890123 1e400\n";
+		// no faces, so no vertices would be kept: check the records instead
+		struct ast_sink
+		{
+			ast_obj& dat;
+			void vertex(const ast_vert& v) { dat.verts.push_back(v); }
+			void face(const ast_face& f) { dat.faces.push_back(f); }
+		};
+		ast_obj obj;
+		ast_sink sink = { obj };
+		BOOST_TEST(scanner::scan(input.data(), input.data() + input.size(), sink));
+		BOOST_TEST(obj.verts.size() == 3);
+		BOOST_TEST(obj.verts[0].num[0] == 1.5);
+		BOOST_TEST(obj.verts[0].num[1] == -2);
+		BOOST_TEST(obj.verts[0].num[2] == 300);
+		BOOST_TEST(obj.verts[1].num[0] == 0.25);
+		BOOST_TEST(obj.verts[1].num[1] == 4);
+		BOOST_TEST(obj.verts[1].num[2] == -1.5e-3);
+		BOOST_TEST(obj.verts[2].num[0] == 0.1);
+		BOOST_TEST(obj.verts[2].num[1] == 12345678901234567890123.);
+		BOOST_TEST(std::isinf(obj.verts[2].num[2]));
+	}
+
+	BOOST_AUTO_TEST_CASE(relative_indices)
+	{
+		// negative indices refer back from the last vertex defined *so far*,
+		// -1 being that vertex (not from the number of faces, nor the total)
+		const std::string input =
+			"v 0 0 0\n"
+			"v 1 0 0\n"
+			"v 0 1 0\n"
+			"f -3 -2 -1\n"
+			"v 0 0 1\n"
+			"f -4 -2 -1\n"
+			"f 2 -1 -3\n";
+		const std::vector<std::vector<vertex_t>> expected = {
+			{ vertex_t { { 0, 0, 0 } }, vertex_t { { 1, 0, 0 } }, vertex_t { { 0, 1, 0 } } },
+			{ vertex_t { { 0, 0, 0 } }, vertex_t { { 0, 1, 0 } }, vertex_t { { 0, 0, 1 } } },
+			{ vertex_t { { 1, 0, 0 } }, vertex_t { { 0, 0, 1 } }, vertex_t { { 1, 0, 0 } } }
+		};
+
+		auto check = [ &expected ] (const std::tuple<model_t, bool, bool>& res)
+		{
+			BOOST_TEST(std::get<1>(res));
+			BOOST_TEST(std::get<2>(res));
+			const model_t& m = std::get<0>(res);
+			BOOST_TEST(m.mesh().size() == expected.size());
+			for(index_t i = 0; i < std::min(m.mesh().size(), expected.size()); i++)
+			{
+				BOOST_TEST((m.vertex_set()[m.mesh()[i].a()] == expected[i][0]));
+				BOOST_TEST((m.vertex_set()[m.mesh()[i].b()] == expected[i][1]));
+				BOOST_TEST((m.vertex_set()[m.mesh()[i].c()] == expected[i][2]));
+			}
+		};
+
+		auto b = input.begin();
+		check(parse(b, input.end()));
+		check(parse(input.data(), input.data() + input.size(), parse_mode::ast));
+		check(parse(input.data(), input.data() + input.size(), parse_mode::single_pass));
+
+		// pointing before the first vertex
+		const std::string wrong = input + "f -5 -1 -2\n";
+		b = wrong.begin();
+		BOOST_TEST(!std::get<2>(parse(b, wrong.end())));
+		BOOST_TEST(!std::get<2>(parse(wrong.data(), wrong.data() + wrong.size(), parse_mode::ast)));
+		BOOST_TEST(!std::get<2>(parse(wrong.data(), wrong.data() + wrong.size(), parse_mode::single_pass)));
+	}
+
 	std::vector<filesystem::path> fetch_test_data(const std::string& root_str)
 	{
 		std::vector<filesystem::path> data;
@@ -113,6 +218,387 @@ BOOST_AUTO_TEST_SUITE(parser)
 
 	}
 
+	BOOST_DATA_TEST_CASE(
+		parse_file_correct,
+		udata::make(fetch_test_data("./test/data/obj/correct")),
+		file)
+	{
+		auto res = parse_file(file.string());
+		bool syntax = std::get<1>(res);
+		bool semantics = std::get<2>(res);
+
+		BOOST_TEST(syntax);
+		BOOST_TEST(semantics);
+	}
+
+	BOOST_DATA_TEST_CASE(
+		parse_file_semantics_fail,
+		udata::make(fetch_test_data("./test/data/obj/semantics_fail")),
+		file)
+	{
+		auto res = parse_file(file.string());
+		bool syntax = std::get<1>(res);
+		bool semantics = std::get<2>(res);
+
+		BOOST_TEST(syntax);
+		BOOST_TEST(!semantics);
+	}
+
+	BOOST_DATA_TEST_CASE(
+		parse_file_matches_stream,
+		udata::make(fetch_test_data("./test/data/obj")),
+		file)
+	{
+		std::ifstream in(file.string());
+		if(!in.is_open())
+		{
+			BOOST_ERROR("Can't open file");
+			return;
+		}
+
+		const model_t streamed = std::get<0>(parse(in));
+		const model_t mapped = std::get<0>(parse_file(file.string()));
+
+		BOOST_TEST(streamed.vertex_set().size() == mapped.vertex_set().size());
+		BOOST_TEST(streamed.mesh().size() == mapped.mesh().size());
+		if(streamed.vertex_set().size() != mapped.vertex_set().size()
+			|| streamed.mesh().size() != mapped.mesh().size())
+		{
+			return;
+		}
+
+		// the scanner rounds correctly, qi::double_ can be 1 ulp off
+		const auto close = [] (const coord_t a, const coord_t b)
+		{ return std::abs(a - b) <= 4 * std::numeric_limits<coord_t>::epsilon() * std::max(std::abs(a), coord_t(1)); };
+		for(index_t i = 0; i < streamed.vertex_set().size(); i++)
+		{
+			const vertex_t& a = streamed.vertex_set()[i];
+			const vertex_t& b = mapped.vertex_set()[i];
+			BOOST_TEST((close(a.x(), b.x()) && close(a.y(), b.y()) && close(a.z(), b.z())));
+		}
+		for(index_t i = 0; i < streamed.mesh().size(); i++)
+		{
+			BOOST_TEST((streamed.mesh()[i].pnts == mapped.mesh()[i].pnts));
+		}
+	}
+
+	BOOST_DATA_TEST_CASE(
+		single_pass_matches_ast,
+		udata::make(fetch_test_data("./test/data/obj")),
+		file)
+	{
+		const auto ast = parse_file(file.string(), parse_mode::ast);
+		const auto single = parse_file(file.string(), parse_mode::single_pass);
+
+		BOOST_TEST(std::get<1>(ast) == std::get<1>(single));
+		BOOST_TEST(std::get<2>(ast) == std::get<2>(single));
+		BOOST_TEST((std::get<0>(ast).vertex_set() == std::get<0>(single).vertex_set()));
+		BOOST_TEST(std::get<0>(ast).mesh().size() == std::get<0>(single).mesh().size());
+		for(index_t i = 0; i < std::min(std::get<0>(ast).mesh().size(), std::get<0>(single).mesh().size()); i++)
+		{
+			BOOST_TEST((std::get<0>(ast).mesh()[i].pnts == std::get<0>(single).mesh()[i].pnts));
+		}
+	}
+
+	void check_identical(
+		const std::tuple<model_t, bool, bool>& a,
+		const std::tuple<model_t, bool, bool>& b)
+	{
+		BOOST_TEST(std::get<1>(a) == std::get<1>(b));
+		BOOST_TEST(std::get<2>(a) == std::get<2>(b));
+		BOOST_TEST((std::get<0>(a).vertex_set() == std::get<0>(b).vertex_set()));
+		BOOST_TEST(std::get<0>(a).mesh().size() == std::get<0>(b).mesh().size());
+		for(index_t i = 0; i < std::min(std::get<0>(a).mesh().size(), std::get<0>(b).mesh().size()); i++)
+		{
+			BOOST_TEST((std::get<0>(a).mesh()[i].pnts == std::get<0>(b).mesh()[i].pnts));
+		}
+	}
+
+	BOOST_DATA_TEST_CASE(
+		chunked_matches_single_pass,
+		udata::make(fetch_test_data("./test/data/obj")),
+		file)
+	{
+		mapped_file in(file.string());
+		BOOST_TEST(in.is_open());
+
+		const auto serial = parse(in, parse_mode::single_pass, 1);
+		check_identical(serial, parse(in, parse_mode::single_pass, 4));
+		// force lots of (tiny) chunks, so relative and forward references cross chunks
+		for(const size_t chunk: { size_t(1), size_t(61), size_t(4096) })
+		{
+			for(const unsigned threads: { 2u, 3u, 8u })
+			{
+				check_identical(serial, parse_chunked(in.begin(), in.end(), threads, chunk));
+			}
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(chunked_relative_indices)
+	{
+		const std::string input =
+			"v 0 0 0\r\n"
+			"v 1 0 0\r\n"
+			"f 3 2 1\r\n" // forward reference
+			"v 0 1 0\r\n"
+			"f -3 -2 -1\r\n"
+			"f 1 2\r\n" // not a triangle
+			"v 0 0 1\r\n"
+			"f -4 -2 -1\r\n"
+			"f -9 1 2\r\n" // out of bounds
+			"f 2 -1 -3\r\n";
+		const char* f = input.data();
+		const char* l = input.data() + input.size();
+		const auto serial = parse(f, l, parse_mode::single_pass, 1);
+		BOOST_TEST(std::get<0>(serial).mesh().size() == 4);
+		BOOST_TEST(!std::get<2>(serial));
+		for(unsigned threads = 2; threads < 12; threads++)
+		{
+			check_identical(serial, parse_chunked(f, l, threads, 1));
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(warnings_to_log)
+	{
+		const std::string input =
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+			"f 1 2\n"
+			"f 1 2 9\n"
+			"f 1 2 3\n";
+		const char* f = input.data();
+		const char* l = input.data() + input.size();
+		std::ostringstream serial;
+		std::ostringstream chunked;
+		std::ostringstream ast;
+		parse(f, l, parse_mode::single_pass, 1, serial);
+		parse(f, l, parse_mode::single_pass, 3, chunked);
+		parse(f, l, parse_mode::ast, 1, ast);
+		BOOST_TEST(serial.str().find("face 1") != std::string::npos);
+		BOOST_TEST(serial.str().find("index 9") != std::string::npos);
+		BOOST_TEST(chunked.str() == serial.str());
+		BOOST_TEST(ast.str() == serial.str());
+	}
+
+	BOOST_AUTO_TEST_CASE(instrument_counters)
+	{
+		const std::string input =
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0 0 1\n"
+			"f 1 2\n"
+			"f 1 2 9\n"
+			"f 1 2 3\n";
+		const char* f = input.data();
+		const char* l = input.data() + input.size();
+		const instrument::registry& r = instrument::global();
+		const auto count = [ &r ] (const instrument::counter c) { return r.counts[size_t(c)].load(); };
+		for(const unsigned threads: { 1u, 3u })
+		{
+			for(const parse_mode mode: { parse_mode::single_pass, parse_mode::ast })
+			{
+				instrument::reset();
+				std::ostringstream log;
+				parse(f, l, mode, threads, log);
+				BOOST_TEST(count(instrument::counter::bytes_read) == input.size());
+				BOOST_TEST(count(instrument::counter::vertices_read) == 4);
+				BOOST_TEST(count(instrument::counter::vertices_unused) == 1);
+				BOOST_TEST(count(instrument::counter::faces_read) == 3);
+				BOOST_TEST(count(instrument::counter::faces_accepted) == 1);
+				BOOST_TEST(count(instrument::counter::faces_dropped) == 2);
+				BOOST_TEST(r.calls[size_t(instrument::timer::parse)].load() == 1);
+				BOOST_TEST(r.calls[size_t(instrument::timer::remap)].load() == 1);
+			}
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(warnings_limited)
+	{
+		std::ostringstream out;
+		{
+			instrument::limited_log log(out, 2);
+			for(int i = 1; i <= 5; i++)
+			{
+				log << "**Warning: index " << -i << " not pointing to valid vertex for face " << 10 * i << "\n";
+			}
+			log << "**Warning: too many or too few vertices in face 3 (ignoring this face)\n";
+			log << "Unable to extract model from 'x'\n";
+		}
+		BOOST_TEST(out.str() ==
+			"**Warning: index -1 not pointing to valid vertex for face 10\n"
+			"**Warning: index -2 not pointing to valid vertex for face 20\n"
+			"**Warning: too many or too few vertices in face 3 (ignoring this face)\n"
+			"Unable to extract model from 'x'\n"
+			"**Warning: 3 more like '**Warning: index -# not pointing to valid vertex for face #'\n");
+	}
+
+	BOOST_DATA_TEST_CASE(
+		cache_round_trip,
+		udata::make(fetch_test_data("./test/data/obj")),
+		file)
+	{
+		const filesystem::path dir = filesystem::temp_directory_path() / filesystem::unique_path();
+		const std::string source = file.string();
+		const std::string path = cache_path(source, dir.string());
+
+		mapped_file in(source);
+		const auto res = parse(in);
+		const model_t& m = std::get<0>(res);
+		const mesh_stats stats = calculate_mesh_stats(m, 1);
+		BOOST_TEST(write_cache(path, m, stats, std::get<1>(res), std::get<2>(res),
+			describe_source(source, in.begin(), in.end())));
+
+		{
+			cached_model cached(path);
+			BOOST_TEST(cached.is_open());
+			BOOST_TEST(cached.fresh(source));
+			BOOST_TEST(cached.syntax() == std::get<1>(res));
+			BOOST_TEST(cached.semantics() == std::get<2>(res));
+
+			// the arrays are used in place
+			const model_view_t& view = cached.view();
+			BOOST_TEST(view.vertex_set().size() == m.vertex_set().size());
+			BOOST_TEST(view.mesh().size() == m.mesh().size());
+			BOOST_TEST(std::equal(m.vertex_set().begin(), m.vertex_set().end(), view.vertex_set().begin()));
+			for(index_t i = 0; i < std::min(view.mesh().size(), m.mesh().size()); i++)
+			{
+				BOOST_TEST((view.mesh()[i].pnts == m.mesh()[i].pnts));
+			}
+
+			const mesh_stats again = calculate_mesh_stats(view, 1);
+			BOOST_TEST((cached.stats().range() == stats.range()));
+			BOOST_TEST(cached.stats().surface() == stats.surface());
+			BOOST_TEST(cached.stats().volume() == stats.volume());
+			BOOST_TEST(again.surface() == stats.surface());
+			BOOST_TEST(again.volume() == stats.volume());
+		}
+
+		// another source (of another size) or a damaged cache
+		{
+			const std::string other = (dir / "other.obj").string();
+			std::ofstream(other) << "v 0 0 0\n";
+			cached_model cached(path);
+			BOOST_TEST(!cached.fresh(other));
+		}
+		filesystem::resize_file(path, filesystem::file_size(path) - 1);
+		BOOST_TEST(!cached_model(path).is_open());
+		filesystem::remove_all(dir);
+	}
+
+	BOOST_AUTO_TEST_CASE(cache_tampered_header)
+	{
+		const filesystem::path dir = filesystem::temp_directory_path() / filesystem::unique_path();
+		filesystem::create_directory(dir);
+		const std::string path = (dir / "tetrahedron.cache").string();
+		const std::string input =
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0 0 1\n"
+			"f 1 3 2\nf 1 2 4\nf 1 4 3\nf 2 3 4\n";
+		const auto res = parse(input.data(), input.data() + input.size());
+		const model_t& m = std::get<0>(res);
+		const cache_source src = { input.size(), 0, 0 };
+
+		// counts that only match the size of the file once their arrays wrap around,
+		// and more vertices than the file holds
+		const auto wrap = [] (const size_t size) { return uint64_t(1) << (64 - __builtin_ctzll(size)); };
+		const uint64_t counts[][2] = {
+			{ m.vertex_set().size() + wrap(sizeof(vertex_t)), m.mesh().size() },
+			{ m.vertex_set().size(), m.mesh().size() + wrap(sizeof(face_t)) },
+			{ uint64_t(1) << 20, m.mesh().size() } };
+		for(const auto& c: counts)
+		{
+			BOOST_TEST(write_cache(path, m, calculate_mesh_stats(m, 1), true, true, src));
+			BOOST_TEST(cached_model(path).is_open());
+			{
+				std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+				f.seekp(offsetof(cache_header, vertices));
+				f.write(reinterpret_cast<const char*>(&c[0]), sizeof(uint64_t));
+				f.seekp(offsetof(cache_header, faces));
+				f.write(reinterpret_cast<const char*>(&c[1]), sizeof(uint64_t));
+			}
+			BOOST_TEST(!cached_model(path).is_open());
+		}
+
+		// only part of the header
+		filesystem::resize_file(path, sizeof(cache_header) / 2);
+		BOOST_TEST(!cached_model(path).is_open());
+		filesystem::remove_all(dir);
+	}
+
+	void check_streamed(const std::string& path, const size_t memory, const size_t buffer)
+	{
+		std::ostringstream parsed_log;
+		std::ostringstream streamed_log;
+		mapped_file in(path);
+		const auto res = parse(in, parse_mode::single_pass, 1, parsed_log);
+		const mesh_stats stats = calculate_mesh_stats(std::get<0>(res), 1);
+		const auto streamed = stream_stats(path, memory, buffer, streamed_log);
+
+		BOOST_TEST((std::get<0>(streamed).range() == stats.range()));
+		BOOST_TEST(std::get<0>(streamed).surface() == stats.surface());
+		BOOST_TEST(std::get<0>(streamed).volume() == stats.volume());
+		BOOST_TEST(std::get<1>(streamed) == std::get<1>(res));
+		BOOST_TEST(std::get<2>(streamed) == std::get<2>(res));
+		BOOST_TEST(std::get<3>(streamed) == std::get<0>(res).mesh().size());
+		BOOST_TEST(streamed_log.str() == parsed_log.str());
+	}
+
+	BOOST_DATA_TEST_CASE(
+		stream_matches_parse,
+		udata::make(fetch_test_data("./test/data/obj")),
+		file)
+	{
+		// in memory, and with every vertex in the temporary file and lines
+		// that are cut by (and don't fit in) the buffer
+		check_streamed(file.string(), size_t(256) << 20, size_t(1) << 20);
+		check_streamed(file.string(), 0, 61);
+	}
+
+	BOOST_AUTO_TEST_CASE(stream_forward_references)
+	{
+		const filesystem::path path = filesystem::temp_directory_path() / filesystem::unique_path();
+		std::ofstream(path.string())
+			<< "v 0 0 0\r\n"
+			<< "v 1 0 0\r\n"
+			<< "f 3 2 1\r\n" // forward reference
+			<< "v 0 1 0\r\n"
+			<< "f -3 -2 -1\r\n"
+			<< "f 1 2\r\n" // not a triangle
+			<< "v 0 0 1\r\n"
+			<< "f -4 -2 -1\r\n"
+			<< "f -9 1 2\r\n" // out of bounds
+			<< "f 2 -1 5\r\n"; // out of bounds
+		for(const size_t buffer: { size_t(2), size_t(7), size_t(1) << 20 })
+		{
+			check_streamed(path.string(), 0, buffer);
+			check_streamed(path.string(), 1 << 10, buffer);
+		}
+		filesystem::remove(path);
+	}
+
+	BOOST_AUTO_TEST_CASE(stream_warnings_bounded)
+	{
+		const filesystem::path path = filesystem::temp_directory_path() / filesystem::unique_path();
+		const size_t bad = stats_pass::late_limit + 100;
+		{
+			std::ofstream out(path.string());
+			out << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+			for(size_t i = 0; i < bad; i++)
+			{
+				out << "f 1 2 9\nf 1 2\n";
+			}
+		}
+		std::ostringstream parsed_log;
+		std::ostringstream streamed_log;
+		mapped_file in(path.string());
+		parse(in, parse_mode::single_pass, 1, parsed_log);
+		stream_stats(path.string(), 0, size_t(1) << 20, streamed_log);
+
+		// the same warnings, up to the ones that are only counted
+		const std::string kept = streamed_log.str().substr(0, streamed_log.str().rfind("**Warning: 100 more"));
+		BOOST_TEST(kept.size() < streamed_log.str().size());
+		BOOST_TEST(parsed_log.str().compare(0, kept.size(), kept) == 0);
+		BOOST_TEST(streamed_log.str().substr(kept.size()) ==
+			"**Warning: 100 more faces ignored due to indices not pointing to valid vertices\n");
+		filesystem::remove(path);
+	}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif // TEST_PARSER
@@ -122,6 +608,19 @@ BOOST_AUTO_TEST_SUITE_END()
 #include "../algo/bounding.hxx"
 #include "../algo/surface.hxx"
 #include "../algo/volume.hxx"
+#include "../algo/stats.hxx"
+#include "../algo/simd.hxx"
+#include "../main/precision.hxx"
+#include "../main/bvh.hxx"
+#include "../main/broadphase.hxx"
+#include "../main/editable.hxx"
+#include "../main/weld.hxx"
+#include "../main/pipeline.hxx"
+#include "../main/server.hxx"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include "../main/bbox.hxx"
 
 BOOST_AUTO_TEST_SUITE(algo)
@@ -508,6 +1007,580 @@ BOOST_AUTO_TEST_SUITE(algo)
 		BOOST_TEST((std::abs(vol_oct - calculate_volume(oct)) <= 0.00000001)); // close enough
 	}
 
+	BOOST_DATA_TEST_CASE(
+		mesh_stats_fused,
+		udata::make(parser::fetch_test_data("./test/data/obj")),
+		file)
+	{
+		const model_t m = std::get<0>(parse_file(file.string()));
+
+		const mesh_stats stats = calculate_mesh_stats(m, 1);
+		BOOST_TEST((stats.range() == calculate_aabb(m)));
+		BOOST_TEST(std::abs(stats.surface() - calculate_surface(m)) <= 1e-9 * std::max(1., calculate_surface(m)));
+		BOOST_TEST(std::abs(stats.volume() - calculate_volume(m)) <= 1e-9 * std::max(1., std::abs(calculate_volume(m))));
+
+		// same bits, whatever the number of threads
+		for(const unsigned threads: { 2u, 3u, 8u })
+		{
+			const mesh_stats other = calculate_mesh_stats(m, threads);
+			BOOST_TEST((other.range() == stats.range()));
+			BOOST_TEST(other.surface() == stats.surface());
+			BOOST_TEST(other.volume() == stats.volume());
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(mesh_stats_compensated)
+	{
+		// millions of copies of one triangle with a surface/volume that
+		// can't be represented exactly: the sums should stay (almost) exact
+		model_t m;
+		m.vertex_set() = {
+			vertex_t { { 0.1, 0.2, 0.3 } },
+			vertex_t { { 1.7, 0.3, 0.9 } },
+			vertex_t { { 0.4, 1.1, 0.7 } } };
+		const index_t n = index_t(1) << 22;
+		m.mesh().assign(n, face_t(std::make_tuple(index_t(0), index_t(1), index_t(2))));
+
+		const scalar_t surf = triangle_surface(m.vertex_set()[0], m.vertex_set()[1], m.vertex_set()[2]);
+		const scalar_t vol = signed_volume(m.vertex_set()[0], m.vertex_set()[1], m.vertex_set()[2]);
+
+		// n is a power of 2: the exact results are representable
+		const mesh_stats stats = calculate_mesh_stats(m);
+		BOOST_TEST(stats.surface() == surf * n);
+		BOOST_TEST(stats.volume() == vol * n);
+	}
+
+	BOOST_DATA_TEST_CASE(
+		soa_kernels,
+		udata::make(parser::fetch_test_data("./test/data/obj")),
+		file)
+	{
+		const model_t m = std::get<0>(parse_file(file.string()));
+		const soa_model_t soa = to_soa(m);
+
+		BOOST_TEST(soa.vertex_set().size() == m.vertex_set().size());
+		BOOST_TEST((calculate_aabb(soa.vertex_set().begin(), soa.vertex_set().end()) == calculate_aabb(m)));
+
+		const scalar_t surf = calculate_surface(m);
+		const scalar_t vol = calculate_volume(m);
+		for(const simd::isa i: { simd::isa::scalar, simd::isa::sse2, simd::isa::avx2 })
+		{
+			if(!simd::supported(i))
+			{
+				continue;
+			}
+			BOOST_TEST((calculate_aabb(soa, i) == calculate_aabb(m)));
+			BOOST_TEST(std::abs(calculate_surface(soa, i) - surf) <= 1e-9 * std::max(1., surf));
+			BOOST_TEST(std::abs(calculate_volume(soa, i) - vol) <= 1e-9 * std::max(1., std::abs(vol)));
+
+			const mesh_stats stats = calculate_mesh_stats(soa, 3, i);
+			BOOST_TEST((stats.range() == calculate_aabb(m)));
+			BOOST_TEST(std::abs(stats.surface() - surf) <= 1e-9 * std::max(1., surf));
+			BOOST_TEST(std::abs(stats.volume() - vol) <= 1e-9 * std::max(1., std::abs(vol)));
+		}
+	}
+
+	// checks aabb, surface and volume of a converted model against the bounds
+	// of precision.hxx, when every vertex moved at most d
+	template<typename M>
+	void check_precision(const model_t& m, const M& conv, const scalar_t d)
+	{
+		BOOST_TEST(conv.vertex_set().size() == m.vertex_set().size());
+		BOOST_TEST(conv.mesh().size() == m.mesh().size());
+
+		scalar_t surf_err = 0;
+		scalar_t vol_err = 0;
+		for(const face_t& f: m.mesh())
+		{
+			const scalar_t a = m.vertex_set()[f.a()].norm();
+			const scalar_t b = m.vertex_set()[f.b()].norm();
+			const scalar_t c = m.vertex_set()[f.c()].norm();
+			surf_err += d * (m.vertex_set()[f.a()].to(m.vertex_set()[f.b()]).norm()
+				+ m.vertex_set()[f.a()].to(m.vertex_set()[f.c()]).norm()) + 2 * d * d;
+			vol_err += (d * (a * b + a * c + b * c) + d * d * (a + b + c) + d * d * d) / 6;
+		}
+
+		// (plus the rounding of the calculations themselves)
+		const scalar_t surf = calculate_surface(m);
+		const scalar_t vol = calculate_volume(m);
+		BOOST_TEST(std::abs(calculate_surface(conv) - surf) <= surf_err + 1e-9 * std::max(1., surf));
+		BOOST_TEST(std::abs(calculate_volume(conv) - vol) <= vol_err + 1e-9 * std::max(1., std::abs(vol)));
+
+		const range_t box = calculate_aabb(m);
+		const range_t cbox = calculate_aabb(conv);
+		BOOST_TEST(box.first.to(cbox.first).norm() <= d);
+		BOOST_TEST(box.second.to(cbox.second).norm() <= d);
+		BOOST_TEST((aabb(conv) == aabb(cbox)));
+
+		const mesh_stats stats = calculate_mesh_stats(conv, 3);
+		BOOST_TEST((stats.range() == cbox));
+		BOOST_TEST(std::abs(stats.surface() - calculate_surface(conv)) <= 1e-9 * std::max(1., surf));
+		BOOST_TEST(std::abs(stats.volume() - calculate_volume(conv)) <= 1e-9 * std::max(1., std::abs(vol)));
+	}
+
+	BOOST_DATA_TEST_CASE(
+		reduced_precision,
+		udata::make(parser::fetch_test_data("./test/data/obj")),
+		file)
+	{
+		BOOST_TEST(sizeof(single_precision::vertex_type) == 12);
+		BOOST_TEST(sizeof(single_precision::face_type) == 12);
+		BOOST_TEST(sizeof(quantized_precision::vertex_type) == 6);
+
+		const model_t m = std::get<0>(parse_file(file.string()));
+
+		scalar_t max_norm = 0;
+		for(const vertex_t& v: m.vertex_set())
+		{
+			max_norm = std::max(max_norm, v.norm());
+		}
+		const float_model_t fm = convert<single_precision>(m);
+		check_precision(m, fm, max_norm * std::ldexp(1., -24));
+
+		// (the aabb is kept, up to the rounding of the last step)
+		const quantized_model_t qm = convert<quantized_precision>(m);
+		check_precision(m, qm, qm.vertex_set().max_error().norm() * (1 + 1e-9) + 1e-12 * max_norm);
+
+		// back and forth keeps the faces
+		const model_t back = convert<double_precision>(qm);
+		BOOST_TEST(back.mesh().size() == m.mesh().size());
+		for(index_t i = 0; i < std::min(back.mesh().size(), m.mesh().size()); i++)
+		{
+			BOOST_TEST((back.mesh()[i].pnts == m.mesh()[i].pnts));
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(precision_index_width)
+	{
+		typedef precision<float, uint8_t> tiny_precision;
+		model_t m;
+		for(int i = 0; i < 300; i++)
+		{
+			m.vertex_set().push_back(vertex_t(std::make_tuple(scalar_t(i), 0., 0.)));
+		}
+		m.mesh().push_back(face_t(std::make_tuple(index_t(0), index_t(1), index_t(299))));
+		BOOST_CHECK_THROW(convert<tiny_precision>(m), std::length_error);
+		m.vertex_set().erase(m.vertex_set().begin() + 3, m.vertex_set().end());
+		m.mesh()[0] = face_t(std::make_tuple(index_t(0), index_t(1), index_t(2)));
+		BOOST_TEST(convert<tiny_precision>(m).mesh().size() == 1);
+	}
+
+	BOOST_DATA_TEST_CASE(
+		bvh_queries,
+		udata::make(parser::fetch_test_data("./test/data/obj")),
+		file)
+	{
+		const model_t m = std::get<0>(parse_file(file.string()));
+		const bvh tree(m, 1);
+		const bvh par(m, 3);
+
+		// every face in exactly one leaf, whatever the number of threads
+		BOOST_TEST(tree.faces() == par.faces());
+		BOOST_TEST(tree.nodes().size() == par.nodes().size());
+		std::vector<index_t> all(tree.faces());
+		std::sort(all.begin(), all.end());
+		for(index_t i = 0; i < all.size(); i++)
+		{
+			BOOST_TEST(all[i] == i);
+		}
+		for(const bvh::node& nd: tree.nodes())
+		{
+			for(index_t i = nd.offset; nd.leaf() && i < nd.offset + nd.count; i++)
+			{
+				const face_t& f = m.mesh()[tree.faces()[i]];
+				BOOST_TEST((nd.box >= m.vertex_set()[f.a()]));
+				BOOST_TEST((nd.box >= m.vertex_set()[f.b()]));
+				BOOST_TEST((nd.box >= m.vertex_set()[f.c()]));
+			}
+		}
+		if(m.mesh().empty())
+		{
+			return;
+		}
+
+		// against checking every face
+		const aabb box(m);
+		std::mt19937 gen(42);
+		std::uniform_real_distribution<double> dx(box.min_x(), box.max_x());
+		std::uniform_real_distribution<double> dy(box.min_y(), box.max_y());
+		std::uniform_real_distribution<double> dz(box.min_z(), box.max_z());
+		std::uniform_real_distribution<double> dd(-1, 1);
+		for(int q = 0; q < 20; q++)
+		{
+			const aabb query(vertex_set_t { vertex_t { { dx(gen), dy(gen), dz(gen) } }, vertex_t { { dx(gen), dy(gen), dz(gen) } } });
+			std::vector<index_t> expected;
+			for(index_t i = 0; i < m.mesh().size(); i++)
+			{
+				const face_t& f = m.mesh()[i];
+				if(bvh::overlaps(m.vertex_set()[f.a()], m.vertex_set()[f.b()], m.vertex_set()[f.c()], query))
+				{
+					expected.push_back(i);
+				}
+			}
+			BOOST_TEST(tree.overlapping(query) == expected);
+
+			const vertex_t origin { { dx(gen), dy(gen), dz(gen) } };
+			const vertex_t dir { { dd(gen), dd(gen), dd(gen) } };
+			bool hit = false;
+			index_t face = 0;
+			scalar_t t = std::numeric_limits<scalar_t>::infinity();
+			size_t crossed = 0;
+			for(index_t i = 0; i < m.mesh().size(); i++)
+			{
+				const face_t& f = m.mesh()[i];
+				const auto res = bvh::intersect(m.vertex_set()[f.a()], m.vertex_set()[f.b()], m.vertex_set()[f.c()], origin, dir);
+				crossed += std::get<0>(res);
+				if(std::get<0>(res) && std::get<1>(res) < t)
+				{
+					hit = true;
+					face = i;
+					t = std::get<1>(res);
+				}
+			}
+			const auto res = tree.ray_cast(origin, dir);
+			BOOST_TEST(std::get<0>(res) == hit);
+			BOOST_TEST((!hit || (std::get<1>(res) == face && std::get<2>(res) == t)));
+			BOOST_TEST(tree.crossings(origin, dir) == crossed);
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(bvh_inside)
+	{
+		// (closed and convex: the mean of the vertices is inside)
+		for(const std::string name: { "cube", "octahedron", "tetrahedron" })
+		{
+			const model_t m = std::get<0>(parse_file("./test/data/obj/correct/" + name + ".OBJ"));
+			const bvh tree(m);
+			const aabb box(m);
+
+			vertex_t centre(0);
+			for(const vertex_t& v: m.vertex_set())
+			{
+				centre = vertex_t { {
+					centre.x() + v.x() / m.vertex_set().size(),
+					centre.y() + v.y() / m.vertex_set().size(),
+					centre.z() + v.z() / m.vertex_set().size() } };
+			}
+			BOOST_TEST(tree.inside(centre));
+			BOOST_TEST(!tree.inside(vertex_t { { box.max_x() + 1, centre.y(), centre.z() } }));
+			BOOST_TEST(!tree.inside(vertex_t { { centre.x(), box.min_y() - 0.5, centre.z() } }));
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(broadphase_pairs)
+	{
+		// integer coordinates: plenty of equal, touching and flat boxes
+		std::mt19937 gen(7);
+		std::uniform_int_distribution<int> pos(0, 40);
+		std::uniform_int_distribution<int> len(0, 3);
+		std::vector<aabb> boxes;
+		for(int i = 0; i < 2000; i++)
+		{
+			const vertex_t mn { { scalar_t(pos(gen)), scalar_t(pos(gen)), scalar_t(pos(gen)) } };
+			boxes.push_back(aabb(range_t(mn, vertex_t { {
+				mn.x() + len(gen), mn.y() + len(gen), mn.z() + len(gen) } })));
+			if(i % 50 == 0)
+			{
+				boxes.push_back(boxes.back());
+			}
+		}
+		// an empty model and one box covering most others
+		boxes.push_back(aabb(model_t()));
+		boxes.push_back(aabb(range_t(vertex_t(2), vertex_t(38))));
+
+		const std::vector<box_pair_t> pairs = overlapping_pairs_brute(boxes);
+		BOOST_TEST(pairs.size() > 0);
+		BOOST_TEST((overlapping_pairs(boxes) == pairs));
+		BOOST_TEST((overlapping_pairs_sweep(boxes) == pairs));
+		BOOST_TEST((overlapping_pairs_grid(boxes) == pairs));
+		BOOST_TEST(overlapping_pairs(std::vector<aabb>()).empty());
+		BOOST_TEST(overlapping_pairs_grid(std::vector<aabb>()).empty());
+	}
+
+	BOOST_AUTO_TEST_CASE(pipeline_order)
+	{
+		const size_t n = 200;
+		const size_t window = 5;
+		std::mutex lock;
+		size_t started = 0;
+		size_t ahead = 0;
+		std::vector<size_t> seen;
+		ordered_pipeline(n, 4, window,
+			[ & ] (const size_t i)
+			{
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					started++;
+					ahead = std::max(ahead, started - seen.size());
+				}
+				// later items tend to finish first
+				std::this_thread::sleep_for(std::chrono::microseconds((n - i) % 7 * 50));
+				return i * i;
+			},
+			[ & ] (const size_t i, const size_t res)
+			{
+				BOOST_TEST(res == i * i);
+				std::lock_guard<std::mutex> guard(lock);
+				seen.push_back(i);
+			});
+		BOOST_TEST(seen.size() == n);
+		for(size_t i = 0; i < seen.size(); i++)
+		{
+			BOOST_TEST(seen[i] == i);
+		}
+		// (plus the one that is being handed to done)
+		BOOST_TEST(ahead <= window + 1);
+	}
+
+	BOOST_AUTO_TEST_CASE(pipeline_exceptions)
+	{
+		const size_t n = 200;
+		size_t last = n;
+		// (thrown on a worker)
+		BOOST_CHECK_THROW(ordered_pipeline(n, 4, 5,
+			[ & ] (const size_t i)
+			{
+				if(i == 50)
+				{
+					throw std::runtime_error("work");
+				}
+				return i;
+			},
+			[ & ] (const size_t i, const size_t)
+			{
+				last = i;
+			}), std::runtime_error);
+		BOOST_TEST(last < 50);
+		// (thrown on the calling thread)
+		last = n;
+		BOOST_CHECK_THROW(ordered_pipeline(n, 4, 5,
+			[ & ] (const size_t i)
+			{
+				return i;
+			},
+			[ & ] (const size_t i, const size_t)
+			{
+				last = i;
+				if(i == 20)
+				{
+					throw std::runtime_error("done");
+				}
+			}), std::runtime_error);
+		BOOST_TEST(last == 20);
+	}
+
+	void check_editable(const editable_model& ed)
+	{
+		const model_t& m = ed.source();
+		const scalar_t surf = calculate_surface(m);
+		const scalar_t vol = calculate_volume(m);
+		BOOST_TEST((ed.box() == aabb(m)));
+		BOOST_TEST((std::abs(ed.surface() - surf) <= 1e-9 * (1 + surf))); // close enough
+		BOOST_TEST((std::abs(ed.volume() - vol) <= 1e-9 * (1 + std::abs(vol)))); // close enough
+	}
+
+	BOOST_DATA_TEST_CASE(
+		editable_updates,
+		udata::make(parser::fetch_test_data("./test/data/obj/correct")),
+		file)
+	{
+		editable_model ed(std::get<0>(parse_file(file.string())));
+		check_editable(ed);
+		const index_t vertices = ed.source().vertex_set().size();
+		if(vertices == 0)
+		{
+			return;
+		}
+
+		std::mt19937 gen(3);
+		std::uniform_real_distribution<double> d(-1, 1);
+		for(int step = 0; step < 300; step++)
+		{
+			const index_t n = ed.source().vertex_set().size();
+			std::uniform_int_distribution<index_t> vi(0, n - 1);
+			switch(step % 4)
+			{
+			case 0:
+				// moves a vertex outwards, then back in (the box shrinks again)
+				{
+					const index_t i = vi(gen);
+					const vertex_t old = ed.source().vertex_set()[i];
+					ed.move_vertex(i, vertex_t { { old.x() * 10, old.y() * 10 + 1, old.z() * 10 } });
+					check_editable(ed);
+					ed.move_vertex(i, old);
+				}
+				break;
+			case 1:
+				BOOST_TEST(ed.move_vertex(vi(gen), vertex_t { { d(gen), d(gen), d(gen) } }));
+				BOOST_TEST(!ed.move_vertex(n, vertex_t { { d(gen), d(gen), d(gen) } }));
+				break;
+			case 2:
+				{
+					const index_t v = ed.add_vertex(vertex_t { { d(gen), d(gen), d(gen) } });
+					BOOST_TEST(ed.add_face(face_t { { vi(gen), v, vi(gen) } }));
+					BOOST_TEST(!ed.add_face(face_t { { v, v + 1, 0 } }));
+				}
+				break;
+			case 3:
+				if(!ed.source().mesh().empty())
+				{
+					BOOST_TEST(ed.remove_face(std::uniform_int_distribution<index_t>(0, ed.source().mesh().size() - 1)(gen)));
+				}
+				BOOST_TEST(!ed.remove_face(ed.source().mesh().size()));
+				break;
+			}
+			check_editable(ed);
+		}
+		BOOST_TEST(ed.source().vertex_set().size() == vertices + 75);
+	}
+
+	BOOST_DATA_TEST_CASE(
+		weld_soup,
+		udata::make(parser::fetch_test_data("./test/data/obj/correct")),
+		file)
+	{
+		const model_t m = std::get<0>(parse_file(file.string()));
+		const aabb box(m);
+		const scalar_t size = std::max( { box.len_x(), box.len_y(), box.len_z(), scalar_t(1) } );
+		const scalar_t eps = size * 1e-9;
+
+		// every face with its own (slightly moved) copies of its vertices,
+		// and some faces twice or collapsed
+		model_t soup;
+		std::mt19937 gen(11);
+		std::uniform_real_distribution<double> jitter(-eps / 4, eps / 4);
+		for(index_t f = 0; f < m.mesh().size(); f++)
+		{
+			const face_t& fc = m.mesh()[f];
+			const index_t first = soup.vertex_set().size();
+			for(const index_t v: { fc.a(), fc.b(), fc.c() })
+			{
+				const vertex_t& p = m.vertex_set()[v];
+				soup.vertex_set().push_back(vertex_t { { p.x() + jitter(gen), p.y() + jitter(gen), p.z() + jitter(gen) } });
+			}
+			soup.mesh().push_back(face_t { { first, first + 1, first + 2 } });
+			if(f % 7 == 0)
+			{
+				soup.mesh().push_back(face_t { { first + 1, first + 2, first } });
+			}
+			if(f % 5 == 0)
+			{
+				soup.mesh().push_back(face_t { { first, first, first + 2 } });
+			}
+		}
+
+		const auto ref = weld(m, 0, false, 1);
+		const auto res = weld(soup, eps, true, 1);
+		const model_t& w = std::get<0>(res);
+		const weld_report& rep = std::get<1>(res);
+		BOOST_TEST(w.vertex_set().size() == std::get<0>(ref).vertex_set().size());
+		BOOST_TEST(w.mesh().size() == std::get<0>(ref).mesh().size());
+		BOOST_TEST(rep.vertices - rep.welded - rep.unused == w.vertex_set().size());
+		BOOST_TEST(rep.faces - rep.degenerate - rep.duplicate == w.mesh().size());
+		BOOST_TEST(rep.duplicate >= (m.mesh().size() + 6) / 7);
+
+		const scalar_t surf = calculate_surface(std::get<0>(ref));
+		const scalar_t vol = calculate_volume(std::get<0>(ref));
+		BOOST_TEST((std::abs(calculate_surface(w) - surf) <= 1e-6 * (1 + surf))); // close enough
+		BOOST_TEST((std::abs(calculate_volume(w) - vol) <= 1e-6 * (1 + std::abs(vol)))); // close enough
+
+		// every face still refers to the same (welded) places
+		for(const face_t& fc: w.mesh())
+		{
+			BOOST_TEST((fc.a() != fc.b() && fc.b() != fc.c() && fc.a() != fc.c()));
+		}
+
+		// the same, whatever the number of threads
+		const auto par = weld(soup, eps, true, 4);
+		BOOST_TEST((std::get<0>(par).vertex_set() == w.vertex_set()));
+		BOOST_TEST(std::get<0>(par).mesh().size() == w.mesh().size());
+		for(index_t f = 0; f < std::min(w.mesh().size(), std::get<0>(par).mesh().size()); f++)
+		{
+			BOOST_TEST((std::get<0>(par).mesh()[f].pnts == w.mesh()[f].pnts));
+		}
+	}
+
+	BOOST_AUTO_TEST_CASE(server_queries)
+	{
+		const filesystem::path dir = filesystem::temp_directory_path() / filesystem::unique_path();
+		filesystem::create_directory(dir);
+		const std::string a = (dir / "a.obj").string();
+		const std::string b = (dir / "b.obj").string();
+		const std::string sock = (dir / "socket").string();
+		const auto tetrahedron = [] (const std::string& path, const int size, const int at)
+		{
+			std::ofstream(path)
+				<< "v " << at << " " << at << " " << at << "\n"
+				<< "v " << at + size << " " << at << " " << at << "\n"
+				<< "v " << at << " " << at + size << " " << at << "\n"
+				<< "v " << at << " " << at << " " << at + size << "\n"
+				<< "f 1 3 2\nf 1 2 4\nf 1 4 3\nf 2 3 4\n";
+		};
+		tetrahedron(a, 1, 0);
+		tetrahedron(b, 1, 5);
+
+		server_options opt;
+		opt.memory = size_t(1) << 20;
+		opt.workers = 1;
+		model_server server(sock, opt);
+		BOOST_REQUIRE(server.is_open());
+		std::thread running([ &server ] () { server.run(); });
+
+		// a client that sends nothing (or half a query) doesn't hold the worker
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		std::strcpy(addr.sun_path, sock.c_str());
+		const int idle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		BOOST_REQUIRE(::connect(idle, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+		BOOST_TEST(::send(idle, "bou", 3, 0) == 3);
+		BOOST_TEST(send_query(sock, "status").value_or("").compare(0, 2, "ok") == 0);
+		// and gets the answers to its queries in order
+		const std::string two = "nds " + a + "\nvolume " + b + "\nquit\n";
+		BOOST_TEST(::send(idle, two.data(), two.size(), 0) == ssize_t(two.size()));
+		std::string got;
+		char chunk[256];
+		for(ssize_t n; (n = ::recv(idle, chunk, sizeof(chunk), 0)) > 0; )
+		{
+			got.append(chunk, size_t(n));
+		}
+		::close(idle);
+		BOOST_TEST(got.compare(0, 18, "ok 0 0 0 1 1 1\nok ") == 0);
+
+		BOOST_TEST(send_query(sock, "bounds " + a).value_or("") == "ok 0 0 0 1 1 1");
+		BOOST_TEST(send_query(sock, "bounds " + a).value_or("") == "ok 0 0 0 1 1 1");
+		BOOST_TEST(send_query(sock, "overlap " + a + " " + b).value_or("") == "ok false");
+		BOOST_TEST(send_query(sock, "stats " + b).value_or("").compare(0, 16, "ok 4 4 5 5 5 6 6") == 0);
+		BOOST_TEST(send_query(sock, "status").value_or("").find("hits 5 misses 2") != std::string::npos);
+		BOOST_TEST(send_query(sock, "volume " + (dir / "none.obj").string()).value_or("").compare(0, 5, "error") == 0);
+		BOOST_TEST(send_query(sock, "bounds").value_or("").compare(0, 5, "error") == 0);
+
+		// a file that changed is read again
+		const auto mtime = std::filesystem::last_write_time(a);
+		tetrahedron(a, 2, 0);
+		std::filesystem::last_write_time(a, mtime + std::chrono::seconds(1));
+		BOOST_TEST(send_query(sock, "bounds " + a).value_or("") == "ok 0 0 0 2 2 2");
+		BOOST_TEST(send_query(sock, "status").value_or("").find("misses 3") != std::string::npos);
+
+		BOOST_TEST(send_query(sock, "shutdown").value_or("") == "ok");
+		running.join();
+		BOOST_TEST(!filesystem::exists(sock));
+
+		// only what fits in the budget is kept, the least recently used goes first
+		const size_t one = model_cache(size_t(1) << 20).get(a) -> bytes;
+		model_cache small(one + one / 2);
+		small.get(a);
+		small.get(b);
+		small.get(b);
+		small.get(a);
+		BOOST_TEST(small.stats().entries == 1);
+		BOOST_TEST(small.stats().hits == 1);
+		BOOST_TEST(small.stats().misses == 3);
+		BOOST_TEST(small.stats().evictions == 2);
+		BOOST_TEST(small.stats().bytes <= one + one / 2);
+
+		filesystem::remove_all(dir);
+	}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif // TEST_ALGO